@@ -0,0 +1,119 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <event-driven/algs.h>
+#include "harness.h"
+
+namespace evbench {
+
+//parameters are the vFramer defaults
+template <typename S>
+static double surfaceUpdate(const scenario &s)
+{
+    S surface;
+    surface.init(s.width, s.height, 5, 0.3);
+
+    auto start = clock::now();
+    for(auto &e : s.events)
+        surface.update(e.x, e.y, e.t, e.p);
+    double seconds = elapsed(start);
+    sink = sink + (uint64_t)surface.getSurface().template at<uchar>(s.height / 2, s.width / 2);
+    return seconds;
+}
+
+//events in packets of 1 ms, each updated as a batch (in parallel when
+//there is more than one core)
+template <typename S>
+static double surfaceBatchUpdate(const scenario &s)
+{
+    S surface;
+    surface.init(s.width, s.height, 5, 0.3);
+    size_t packet = std::max((size_t)(s.rate * 0.001), (size_t)1);
+
+    auto start = clock::now();
+    for(size_t i = 0; i < s.events.size(); i += packet)
+        surface.update(s.events.begin() + i, s.events.begin() + std::min(i + packet, s.events.size()));
+    double seconds = elapsed(start);
+    sink = sink + (uint64_t)surface.getSurface().template at<uchar>(s.height / 2, s.width / 2);
+    return seconds;
+}
+
+//includes reading the surface once, where the decay is applied
+static double lazyErosUpdate(const scenario &s)
+{
+    ev::lazyEROS eros;
+    eros.init(s.width, s.height, 5, 0.3);
+
+    auto start = clock::now();
+    for(auto &e : s.events)
+        eros.update(e.x, e.y);
+    cv::Mat img = eros.getSurface();
+    double seconds = elapsed(start);
+    sink = sink + (uint64_t)img.at<uchar>(s.height / 2, s.width / 2);
+    return seconds;
+}
+
+static double scarfUpdate(const scenario &s)
+{
+    ev::SCARF scarf;
+    scarf.initialise({s.width, s.height}, 10, 1.0, 0.2);
+
+    auto start = clock::now();
+    for(auto &e : s.events)
+        scarf.update(e.x, e.y, e.p);
+    double seconds = elapsed(start);
+    sink = sink + (uint64_t)scarf.getSurface().at<float>(s.height / 2, s.width / 2);
+    return seconds;
+}
+
+//events are added as they arrive and the flow is updated every 10 ms of
+//data, so the time per event includes both
+static double zrtFlowUpdate(const scenario &s)
+{
+    ev::zrtFlow flow;
+    flow.initialise({s.width, s.height}, 40, 40, 2, 20, 0.5, 5);
+
+    double next_update = 0.01;
+    auto start = clock::now();
+    for(auto &e : s.events) {
+        flow.add(e.x, e.y, e.t);
+        if(e.t >= next_update) {
+            flow.update(e.t);
+            next_update += 0.01;
+        }
+    }
+    flow.update(s.events.back().t);
+    return elapsed(start);
+}
+
+void addAlgsBenchmarks(std::vector<benchCase> &cases)
+{
+    cases.push_back({"EROS::update", surfaceUpdate<ev::EROS>});
+    cases.push_back({"EROS<5>::update", surfaceUpdate<ev::basicEROS<5>>});
+    cases.push_back({"EROS::update(batch)", surfaceBatchUpdate<ev::EROS>});
+    cases.push_back({"TOS::update", surfaceUpdate<ev::TOS>});
+    cases.push_back({"TOS<5>::update", surfaceUpdate<ev::basicTOS<5>>});
+    cases.push_back({"TOS::update(batch)", surfaceBatchUpdate<ev::TOS>});
+    cases.push_back({"SITS::update", surfaceUpdate<ev::SITS>});
+    cases.push_back({"SITS<5>::update", surfaceUpdate<ev::basicSITS<5>>});
+    cases.push_back({"lazyEROS::update", lazyErosUpdate});
+    cases.push_back({"SCARF::update", scarfUpdate});
+    cases.push_back({"zrtFlow::update", zrtFlowUpdate});
+}
+
+}
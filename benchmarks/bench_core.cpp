@@ -0,0 +1,125 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Portable.h>
+#include <event-driven/core.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "harness.h"
+
+namespace evbench {
+
+//packets of 1 ms of events are serialised into memory and read back, as a
+//port would receive them
+static double packetRead(const scenario &s, bool compress)
+{
+    size_t per_packet = std::max((size_t)(s.rate * 0.001), (size_t)1);
+    std::vector< ev::packet<ev::AE> > sent;
+    for(size_t i = 0; i < s.events.size(); i += per_packet) {
+        sent.emplace_back();
+        ev::packet<ev::AE> &p = sent.back();
+        size_t n = std::min(per_packet, s.events.size() - i);
+        for(size_t j = i; j < i + n; j++) {
+            ev::AE v;
+            v.x = s.events[j].x; v.y = s.events[j].y; v.p = s.events[j].p;
+#if ENABLE_TS
+            v.ts = (unsigned int)(s.events[j].t * ev::vtsscaler) & ev::max_stamp;
+#endif
+            p.push_back(v);
+        }
+        p.duration(n / s.rate);
+        p.compress(compress);
+    }
+
+    ev::packet<ev::AE> received;
+    uint64_t check = 0;
+    auto start = clock::now();
+    for(auto &p : sent) {
+        yarp::os::Portable::copyPortable(p, received);
+        check += received.size();
+    }
+    double seconds = elapsed(start);
+    sink = sink + check;
+    return seconds;
+}
+
+//a yarpdatadumper log of compressed packets of 1 ms of events is read back
+//with offlineLoader::load() or stream(). The events read must match those
+//written.
+static double logRead(const scenario &s, bool stream)
+{
+    const std::string path = tempPath("ev-benchmarks.log");
+    size_t per_packet = std::max((size_t)(s.rate * 0.001), (size_t)1);
+
+    std::vector<ev::AE> written(s.events.size());
+    std::ofstream log(path);
+    std::vector<uint8_t> wire;
+    for(size_t i = 0; i < s.events.size(); i += per_packet) {
+        size_t n = std::min(per_packet, s.events.size() - i);
+        for(size_t j = i; j < i + n; j++) {
+            ev::AE &v = written[j];
+            v = ev::AE();
+            v.x = s.events[j].x; v.y = s.events[j].y; v.p = s.events[j].p;
+#if ENABLE_TS
+            v.ts = (unsigned int)(s.events[j].t * ev::vtsscaler) & ev::max_stamp;
+#endif
+        }
+        ev::compressor<ev::AE>::encode(&written[i], n, wire);
+        yarp::os::Bottle b;
+        b.addInt32(i / per_packet);
+        b.addFloat64(s.events[i + n - 1].t);
+        b.addString(ev::compressor<ev::AE>::tag());
+        b.addInt32((int)(n / s.rate * 1e6));
+        b.addString(std::string(wire.begin(), wire.end()));
+        log << b.toString() << std::endl;
+    }
+    log.close();
+
+    ev::offlineLoader<ev::AE> loader;
+    auto start = clock::now();
+    if(!(stream ? loader.stream(path) : loader.load(path))) return -1.0;
+    loader.synchroniseRealtimeRead(0.0);
+    size_t i = 0;
+    bool match = true;
+    for(double t = 0.1; loader.incrementReadTill(t); t += 0.1) {
+        for(auto &v : loader) {
+            match = match && i < written.size() && !std::memcmp(&v, &written[i], sizeof(ev::AE));
+            i++;
+        }
+    }
+    double seconds = elapsed(start);
+    std::remove(path.c_str());
+    if(!match || i != written.size()) {
+        yError() << "offlineLoader read" << i << "of" << written.size() << "events," << (match ? "all" : "not all") << "matching";
+        return -1.0;
+    }
+    return seconds;
+}
+
+void addCoreBenchmarks(std::vector<benchCase> &cases)
+{
+    cases.push_back({"packet::read", [](const scenario &s) { return packetRead(s, false); }});
+    cases.push_back({"packet::read/compressed", [](const scenario &s) { return packetRead(s, true); }});
+    cases.push_back({"offlineLoader::load/compressed", [](const scenario &s) { return logRead(s, false); }});
+    cases.push_back({"offlineLoader::stream/compressed", [](const scenario &s) { return logRead(s, true); }});
+}
+
+}
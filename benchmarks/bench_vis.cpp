@@ -0,0 +1,83 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <event-driven/vis.h>
+#include <cstdio>
+#include <fstream>
+#include "harness.h"
+
+namespace evbench {
+
+//typical vPreProcess --filter_s and --filter_t values
+static double noiseFilterCheck(const scenario &s)
+{
+    ev::vNoiseFilter filter;
+    filter.initialise(s.width, s.height);
+    filter.use_spatial_filter(0.01);
+    filter.use_temporal_filter(0.001);
+
+    uint64_t kept = 0;
+    auto start = clock::now();
+    for(auto &e : s.events)
+        kept += filter.check(e.x, e.y, e.p, e.t);
+    double seconds = elapsed(start);
+    sink = sink + kept;
+    return seconds;
+}
+
+//a mildly distorted camera, written to a calibration file as vPreProcess
+//would load it
+static double sparseForwardTransform(const scenario &s)
+{
+    std::string path = tempPath("ev-benchmarks-calibration.ini");
+    std::ofstream calibration(path);
+    calibration << "[CAMERA_CALIBRATION_LEFT]" << std::endl
+                << "w " << s.width << std::endl
+                << "h " << s.height << std::endl
+                << "fx " << s.width * 0.8 << std::endl
+                << "fy " << s.width * 0.8 << std::endl
+                << "cx " << s.width * 0.5 << std::endl
+                << "cy " << s.height * 0.5 << std::endl
+                << "k1 -0.1" << std::endl << "k2 0.01" << std::endl
+                << "p1 0.0" << std::endl << "p2 0.0" << std::endl;
+    calibration.close();
+
+    ev::vIPT ipt;
+    bool configured = ipt.configure(path);
+    std::remove(path.c_str());
+    if(!configured) return -1.0;
+
+    uint64_t valid = 0;
+    auto start = clock::now();
+    for(auto &e : s.events) {
+        int x = e.x, y = e.y;
+        valid += ipt.sparseForwardTransform(0, y, x);
+        valid += x + y;
+    }
+    double seconds = elapsed(start);
+    sink = sink + valid;
+    return seconds;
+}
+
+void addVisBenchmarks(std::vector<benchCase> &cases)
+{
+    cases.push_back({"vNoiseFilter::check", noiseFilterCheck});
+    cases.push_back({"vIPT::sparseForwardTransform", sparseForwardTransform});
+}
+
+}
@@ -0,0 +1,113 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace evbench {
+
+/// \brief a synthetic event, t in seconds
+struct event
+{
+    int x, y, p;
+    double t;
+};
+
+/// \brief a synthetic stream at a resolution and event rate
+struct scenario
+{
+    int width, height;
+    double rate;
+    std::vector<event> events;
+};
+
+/// \brief a bar sweeping across the sensor, giving edge events of both
+/// polarities, with uniformly distributed noise events mixed in. The stream
+/// only depends on the seed.
+inline std::vector<event> generate(int width, int height, double rate, size_t n, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> rx(0, width - 1), ry(0, height - 1), rp(0, 1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> spread(0.0, 1.5);
+
+    const double noise = 0.2;
+    const double sweep = 0.5; //seconds for the bar to cross the sensor
+    const int bar = std::max(width / 20, 4);
+
+    std::vector<event> events(n);
+    for(size_t i = 0; i < n; i++) {
+        event &e = events[i];
+        e.t = i / rate;
+        if(unit(rng) < noise) {
+            e.x = rx(rng); e.y = ry(rng); e.p = rp(rng);
+            continue;
+        }
+        //leading edge is positive, trailing edge negative
+        double front = std::fmod(e.t / sweep, 1.0) * (width + bar);
+        e.p = rp(rng);
+        int x = (int)(front - (e.p ? 0 : bar) + spread(rng));
+        e.x = std::min(std::max(x, 0), width - 1);
+        e.y = ry(rng);
+    }
+    return events;
+}
+
+/// \brief runs the code under test over all events of a scenario once and
+/// returns the seconds spent, excluding any set-up
+using benchFunction = std::function<double(const scenario &)>;
+
+struct benchCase
+{
+    std::string name;
+    benchFunction run;
+};
+
+using clock = std::chrono::steady_clock;
+
+inline double elapsed(clock::time_point start)
+{
+    return std::chrono::duration<double>(clock::now() - start).count();
+}
+
+/// \brief path of a temporary file called name, in $TMPDIR or /tmp
+inline std::string tempPath(const std::string &name)
+{
+    const char *dir = std::getenv("TMPDIR");
+    return std::string(dir && *dir ? dir : "/tmp") + "/" + name;
+}
+
+/// \brief keeps results alive so the compiler cannot remove the work
+extern volatile uint64_t sink;
+
+void addCoreBenchmarks(std::vector<benchCase> &cases);
+#ifdef EV_BENCH_OPENCV
+void addAlgsBenchmarks(std::vector<benchCase> &cases);
+void addVisBenchmarks(std::vector<benchCase> &cases);
+#endif
+
+}
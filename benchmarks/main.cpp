@@ -0,0 +1,119 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <yarp/os/all.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include "harness.h"
+
+using yarp::os::Value;
+
+namespace evbench {
+volatile uint64_t sink = 0;
+}
+
+void helpfunction()
+{
+    yInfo() << "USAGE:";
+    yInfo() << "--filter <string> only run benchmarks whose name contains this [all]";
+    yInfo() << "--format <string> json (one object per line) or csv [json]";
+    yInfo() << "--out <string> write results to this file instead of stdout";
+    yInfo() << "--events <int> events in each synthetic stream [1000000]";
+    yInfo() << "--reps <int> timed repetitions, the median is reported [5]";
+    yInfo() << "--seed <int> seed of the synthetic streams [1]";
+    yInfo() << "--rate <double> only use this event rate (events/s) [1e5, 1e6 and 1e7]";
+}
+
+int main(int argc, char *argv[])
+{
+    yarp::os::ResourceFinder rf;
+    rf.configure(argc, argv);
+    if(rf.check("help") || rf.check("h")) {
+        helpfunction();
+        return 0;
+    }
+
+    std::string filter = rf.check("filter", Value("")).asString();
+    std::string format = rf.check("format", Value("json")).asString();
+    size_t n = rf.check("events", Value(1000000)).asInt32();
+    int reps = std::max(rf.check("reps", Value(5)).asInt32(), 1);
+    unsigned int seed = rf.check("seed", Value(1)).asInt32();
+
+    std::vector<double> rates = {1e5, 1e6, 1e7};
+    if(rf.check("rate")) rates = {rf.find("rate").asFloat64()};
+    const std::vector< std::pair<int, int> > resolutions = {{304, 240}, {640, 480}, {1280, 720}};
+
+    std::vector<evbench::benchCase> cases;
+    evbench::addCoreBenchmarks(cases);
+#ifdef EV_BENCH_OPENCV
+    evbench::addAlgsBenchmarks(cases);
+    evbench::addVisBenchmarks(cases);
+#endif
+
+    std::ofstream file;
+    if(rf.check("out")) {
+        file.open(rf.find("out").asString());
+        if(!file.is_open()) {
+            yError() << "Could not open" << rf.find("out").asString();
+            return -1;
+        }
+    }
+    std::ostream &out = file.is_open() ? file : std::cout;
+    if(format == "csv")
+        out << "benchmark,width,height,rate,events,reps,ns_per_event,ns_per_event_min,events_per_s" << std::endl;
+
+    for(auto &r : resolutions) {
+        for(auto rate : rates) {
+            evbench::scenario s{r.first, r.second, rate,
+                                evbench::generate(r.first, r.second, rate, n, seed)};
+            for(auto &c : cases) {
+                if(c.name.find(filter) == std::string::npos) continue;
+                std::cerr << c.name << " " << s.width << "x" << s.height
+                          << " @ " << rate << " events/s" << std::endl;
+
+                //one untimed run to warm the caches
+                if(c.run(s) < 0.0) {
+                    yError() << c.name << "could not be set up, or failed";
+                    continue;
+                }
+                std::vector<double> times;
+                for(int i = 0; i < reps; i++)
+                    times.push_back(c.run(s));
+                std::sort(times.begin(), times.end());
+                double median = times[times.size() / 2];
+                double ns = 1e9 * median / n;
+                double ns_min = 1e9 * times.front() / n;
+                double throughput = n / median;
+
+                if(format == "csv") {
+                    out << c.name << "," << s.width << "," << s.height << "," << rate << ","
+                        << n << "," << reps << "," << ns << "," << ns_min << "," << throughput << std::endl;
+                } else {
+                    out << "{\"benchmark\": \"" << c.name << "\", \"width\": " << s.width
+                        << ", \"height\": " << s.height << ", \"rate\": " << rate
+                        << ", \"events\": " << n << ", \"reps\": " << reps
+                        << ", \"ns_per_event\": " << ns << ", \"ns_per_event_min\": " << ns_min
+                        << ", \"events_per_s\": " << throughput << "}" << std::endl;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
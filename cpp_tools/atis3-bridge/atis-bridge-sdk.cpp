@@ -57,9 +57,16 @@ private:
     static constexpr double period{0.2};
     bool record_mode{false};
     bool gen3{false};
+    bool trace{false};
 
     ev::vNoiseFilter nf;
 
+    //metrics of the camera callback, created on the first callback
+    ev::metrics metrics;
+    ev::metricCounter *camera_events{nullptr};
+    ev::metricCounter *camera_filtered{nullptr};
+    ev::metricHistogram *camera_ns{nullptr};
+
     std::mutex m;
     std::condition_variable signal;
     std::vector< ev::packet<AE> > buffer;
@@ -83,6 +90,9 @@ public:
             yInfo() << "--file <str>\t: (optional) provide file path otherwise search for camera to connect";
             yInfo() << "--limit <int>\t: (optional) provide a hard limit on event rate (in 10^6 events/s)";
             yInfo() << "--s   <int>\t: camera sensitivity (0->100)";
+            yInfo() << "--trace \t: stamp packets for end-to-end latency tracing";
+            yInfo() << "--metrics <bool>\t: publish throughput, timing and cpu metrics on <name>/metrics:o (default true)";
+            yInfo() << "--prometheus <str>\t: also write the metrics to this Prometheus text file";
             return false;
         }
 
@@ -107,6 +117,7 @@ public:
                           "with a cmake parameter VLIB_CLOCK_PERIOD_NS=1000 for correct time scaling.";
 
         limit = rf.check("limit", Value(-1)).asFloat64();
+        trace = rf.check("trace") && rf.check("trace", Value(true)).asBool();
         if(limit < 0) limit  = DBL_MAX;
         else          limit *= 1e6;
 
@@ -198,20 +209,24 @@ public:
 
         //automatically assign port numbers
         std::stringstream ss;
-        ss.str(""); ss << getName() << "/AE:o";
-        if(yarp::os::Network::exists(ss.str())) {
+        ss.str(""); ss << getName();
+        if(yarp::os::Network::exists(ss.str() + "/AE:o")) {
             int port_number = 1; 
             do {
                 port_number++;
-                ss.str(""); ss << getName() << "-" << port_number << "/AE:o";
-            } while(yarp::os::Network::exists(ss.str()));
+                ss.str(""); ss << getName() << "-" << port_number;
+            } while(yarp::os::Network::exists(ss.str() + "/AE:o"));
         }
 
-        if(!output_port.open(ss.str())) {
+        if(!output_port.open(ss.str() + "/AE:o")) {
             yError() << "Could not open output port";
             return false;
         }
 
+        if(rf.check("metrics", Value(true)).asBool() &&
+           !metrics.open(ss.str(), rf.check("prometheus", Value("")).asString()))
+            return false;
+
         if(!cam.start()) {
             yError() << "Could not start the camera";
             return false;
@@ -236,6 +251,7 @@ public:
     {
         cam.stop();
         output_port.close();
+        metrics.close();
         signal.notify_one();
     }
 
@@ -266,7 +282,17 @@ public:
 
     void fill_buffer(const EventCD *begin, const EventCD *end) 
     {
+        if(!camera_ns) {
+            ev::threadMetrics &tm = metrics.thread("camera");
+            camera_events = &tm.counter("events");
+            camera_filtered = &tm.counter("filtered");
+            camera_ns = &tm.histogram("decode_ns");
+        }
+        ev::metricTimer timer(*camera_ns);
+        camera_events->add(end - begin);
+
         std::unique_lock<std::mutex> lk(m);
+        size_t before = buffer[b_sel].size();
         static long long toc = begin->t;
         //fill up the buffer that will be sent over the port in the other thread
         AE ae;
@@ -289,6 +315,7 @@ public:
                 buffer[b_sel].push_back(ae);
             }
         }
+        camera_filtered->add((end - begin) - (buffer[b_sel].size() - before));
         buffer[b_sel].duration(((end-1)->t - toc)*0.000001 + buffer[b_sel].duration());
         toc = (end-1)->t;
         lk.unlock();
@@ -321,6 +348,12 @@ public:
     //asynchronous thread run forever
     void run() override
     {
+        ev::threadMetrics &tm = metrics.thread("send");
+        ev::metricCounter &events = tm.counter("events");
+        ev::metricCounter &bytes = tm.counter("bytes");
+        ev::metricCounter &packets = tm.counter("packets");
+        ev::metricCounter &limited = tm.counter("limited");
+        ev::metricHistogram &send_ns = tm.histogram("send_ns");
         while(true) {
             // wait for data and then switch buffers so the callback can keep
             // filling the second buffer while we are sending
@@ -339,7 +372,17 @@ public:
             if(current_buffer.size() / current_buffer.duration() < limit) 
             {
                 output_port.setEnvelope(yarpstamp);
+                if(trace) {
+                    current_buffer.envelope() = yarpstamp;
+                    current_buffer.trace(getName());
+                }
+                ev::metricTimer timer(send_ns);
                 output_port.write(current_buffer);
+                events.add(current_buffer.size());
+                bytes.add(current_buffer.size() * sizeof(AE));
+                packets.add();
+            } else {
+                limited.add(current_buffer.size());
             }
             counter_packets++;
             counter_events += current_buffer.size();
@@ -47,6 +47,12 @@ private:
 
     //file output
     std::ofstream writer;
+
+    //metrics of updateModule, which runs in the main thread
+    ev::metrics metrics;
+    ev::metricCounter *events{nullptr};
+    ev::metricCounter *frames{nullptr};
+    ev::metricHistogram *frame_ns{nullptr};
     
 
 public:
@@ -63,6 +69,8 @@ public:
             yInfo() << "--cs <double>\t: checker square edge length in metres";
             yInfo() << "--cam <string>\t: port name of event camera";
             yInfo() << "--fisheye     \t: use fisheye calibration mode";
+            yInfo() << "--metrics <bool>\t: publish event rate, frame time and cpu metrics on <name>/metrics:o (default true)";
+            yInfo() << "--prometheus <str>\t: also write the metrics to this Prometheus text file";
             return false;
         }
 
@@ -110,6 +118,14 @@ public:
             return false;
         }
 
+        if(rf.check("metrics", Value(true)).asBool()) {
+            if(!metrics.open(getName(), rf.check("prometheus", Value("")).asString()))
+                return false;
+        }
+        ev::threadMetrics &m = metrics.thread("update");
+        events = &m.counter("events");
+        frames = &m.counter("frames");
+        frame_ns = &m.histogram("frame_ns");
         Network::connect(rf.check("cam", Value("/atis3/AE:o")).asString(), getName("/AE:i"), "fast_tcp");
         
         return true;
@@ -126,6 +142,7 @@ public:
         //black_thread.join();
         input.stop();
         writer.close();
+        metrics.close();
         return true;
     }
 
@@ -138,8 +155,11 @@ public:
                                        board_size.width-1, 
                                        board_size.area()-board_size.width, 
                                        board_size.area()-1};
+        ev::metricTimer timer(*frame_ns);
+        frames->add();
         black_img = ev::black;
         ev::info stats = input.readSlidingWinT(0.033, false);
+        events->add(stats.count);
         for (auto& v : input)
             black_img.at<cv::Vec3b>(v.y, v.x) = white;
 
@@ -27,9 +27,8 @@ using namespace yarp::os;
 class calibration_module : public RFModule {
 
 private:
-    //input port
-    ev::window<ev::AE> cam1;
-    ev::window<ev::AE> cam2;
+    //input ports, source 0 is camera 1 and source 1 is camera 2
+    ev::merged_window<ev::AE> cams;
 
     //provided parameters
     cv::Size img_size_1, img_size_2, board_size;
@@ -49,6 +48,12 @@ private:
 
     //file output
     std::ofstream writer;
+
+    //metrics of updateModule, which runs in the main thread
+    ev::metrics metrics;
+    ev::metricCounter *events{nullptr};
+    ev::metricCounter *frames{nullptr};
+    ev::metricHistogram *frame_ns{nullptr};
     
 
 public:
@@ -66,6 +71,8 @@ public:
             yInfo() << "--cam2cal <string>\t: path to camera 2 parameter file";
             yInfo() << "--cam1 <string>\t: port name of camera 1";
             yInfo() << "--cam2 <string>\t: port name of camera 2";
+            yInfo() << "--metrics <bool>\t: publish event rate, frame time and cpu metrics on <name>/metrics:o (default true)";
+            yInfo() << "--prometheus <str>\t: also write the metrics to this Prometheus text file";
             return false;
         }
 
@@ -141,16 +148,24 @@ public:
         board_info = str_maker.str();
         yInfo() << "board parameters:" << board_info;
 
-        if(!cam1.open(getName("/cam1/AE:i"))) {
+        if(!cams.open(getName("/cam1/AE:i"))) {
             yError() << "could not open input port";
             return false;
         }
 
-        if(!cam2.open(getName("/cam2/AE:i"))) {
+        if(!cams.open(getName("/cam2/AE:i"))) {
             yError() << "could not open input port";
             return false;
         }
         
+        if(rf.check("metrics", Value(true)).asBool()) {
+            if(!metrics.open(getName(), rf.check("prometheus", Value("")).asString()))
+                return false;
+        }
+        ev::threadMetrics &m = metrics.thread("update");
+        events = &m.counter("events");
+        frames = &m.counter("frames");
+        frame_ns = &m.histogram("frame_ns");
         Network::connect(rf.check("cam1", Value("/atis4/cam1/AE:o")).asString(), getName("/cam1/AE:i"), "fast_tcp");
         Network::connect(rf.check("cam2", Value("/atis4/cam2/AE:o")).asString(), getName("/cam2/AE:i"), "fast_tcp");
         
@@ -166,9 +181,9 @@ public:
     {
         //when stop(), isStopping()=true and interruptModule() is called
         //black_thread.join();
-        cam1.stop();
-        cam2.stop();
+        cams.stop();
         writer.close();
+        metrics.close();
         return true;
     }
 
@@ -184,18 +199,21 @@ public:
                                        board_size.area()-board_size.width, 
                                        board_size.area()-1};
 
-        ev::info stats_1 = cam1.readSlidingWinT(0.033, false);
-        ev::info stats_2 = cam2.readSlidingWinT(0.033, stats_1.timestamp);
-        //std::cout << std::fixed << std::setprecision(14);
-        //std::cout << stats_1.timestamp << " " << stats_2.timestamp << " " << stats_1.timestamp - stats_2.timestamp << " " << stats_1.count + stats_2.count << std::endl;
-        //std::cout.flush();
-        
+        ev::metricTimer timer(*frame_ns);
+        frames->add();
+
+        //the last 33 ms of both cameras merged in time order
+        ev::info stats = cams.readSlidingWinT(0.033, false);
+        events->add(stats.count);
+
         black_img_1 = ev::black;
         black_img_2 = ev::black;
-        for (auto& v : cam1)
-            black_img_1.at<cv::Vec3b>(v.y, v.x) = white;
-        for (auto& v : cam2)
-            black_img_2.at<cv::Vec3b>(v.y, v.x) = white;
+        for (auto& v : cams) {
+            if(v.source == 0)
+                black_img_1.at<cv::Vec3b>(v.event.y, v.event.x) = white;
+            else
+                black_img_2.at<cv::Vec3b>(v.event.y, v.event.x) = white;
+        }
 
         std::vector<cv::Point2f> corners_1, corners_2;
         bool calibrated = !R.empty();
@@ -34,6 +34,7 @@ private:
     unsigned int mask;
     unsigned int bits_to_check;
     int cols;
+    ev::metrics metrics;
 
 public:
 
@@ -53,6 +54,8 @@ public:
                        " are shown.";
             yInfo() << "x = don't care | 1 = bit must be set | 0 bit must be clear";
             yInfo() << "example --mask 10x011xx";
+            yInfo() << "--metrics: publish event rate and cpu metrics on <name>/metrics:o (default true)";
+            yInfo() << "--prometheus: also write the metrics to this Prometheus text file";
             return false;
         }
 
@@ -72,6 +75,10 @@ public:
             return false;
         }
 
+        if(rf.check("metrics", Value(true)).asBool() &&
+           !metrics.open(getName(), rf.check("prometheus", Value("")).asString()))
+            return false;
+
         if(yarp::os::Network::connect("/zynqGrabber/AE:o", getName("/AE:i"), "fast_tcp")) {
             yWarning() << "Automatically connected to /zynqGrabber/AE:o but"
                           " maybe that's not what you want!";
@@ -144,6 +151,7 @@ public:
         //when the asynchrnous thread is asked to stop, close ports and do
         //other clean up
         input_port.close();
+        metrics.close();
     }
 
     //synchronous thread
@@ -158,18 +166,28 @@ public:
         std::cout << std::hex << std::setfill('0') << std::internal << std::uppercase;
         int coli = 0;
 
+        ev::threadMetrics &m = metrics.thread("print");
+        ev::metricCounter &events = m.counter("events");
+        ev::metricCounter &packets = m.counter("packets");
+        ev::metricCounter &shown = m.counter("shown");
+        ev::metricGauge &queued = m.gauge("input_queue");
+
         while(!Thread::isStopping()) {
 
             int qs = input_port.getPendingReads();
+            queued.set(qs);
             if(qs < 1) qs = 1;
 
             for(int i = 0; i < qs; i++)
             {
                 ev::packet<ev::encoded> * q = input_port.read();
                 if(!q) return;
+                events.add(q->size());
+                packets.add();
                 for(auto &v : *q)
                 {
                     if((v.data & bits_to_check) == mask) {
+                        shown.add();
                         if(coli++ % cols == 0) std::cout << std::endl;
                         std::cout << "0x" << std::setw(8) << v.data << " ";
                     }
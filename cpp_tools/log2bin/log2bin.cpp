@@ -0,0 +1,101 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <yarp/os/all.h>
+#include <event-driven/core.h>
+#include <string>
+
+using yarp::os::Value;
+
+void helpfunction()
+{
+    yInfo() << "USAGE:";
+    yInfo() << "--file <string> logfile path";
+    yInfo() << "--out <string> output recording [<file>.bin]";
+    yInfo() << "--type <string> event type in the log: AE, IMU, SKS, EAR [AE]";
+    yInfo() << "--threads <int> threads used to parse the log, 0 uses all cores [0]";
+}
+
+template <typename T>
+bool convert(const std::string &in_path, const std::string &out_path, unsigned int threads)
+{
+    ev::metrics metrics;
+    ev::threadMetrics &m = metrics.thread("convert");
+    ev::metricHistogram &load_ns = m.histogram("load_ns");
+    ev::metricHistogram &save_ns = m.histogram("save_ns");
+
+    ev::offlineLoader<T> loader;
+    yInfo() << "Loading log file ... ";
+    bool loaded;
+    {
+        ev::metricTimer timer(load_ns);
+        loaded = loader.load(in_path, DBL_MAX, threads);
+    }
+    if(!loaded) {
+        yError() << "Could not open log file" << in_path;
+        return false;
+    }
+    yInfo() << loader.getinfo();
+
+    yInfo() << "Writing" << out_path;
+    bool saved;
+    {
+        ev::metricTimer timer(save_ns);
+        saved = loader.save(out_path);
+    }
+    if(!saved) {
+        yError() << "Could not write recording" << out_path;
+        return false;
+    }
+    yInfo() << ev::metrics::summary(metrics.snapshot());
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    yarp::os::ResourceFinder rf;
+    rf.configure(argc, argv);
+    if(rf.check("help") || rf.check("h")) {
+        helpfunction();
+        return 0;
+    }
+
+    if(!rf.check("file")) {
+        yError() << "Please provide path to .log containing events";
+        helpfunction();
+        return -1;
+    }
+    std::string file_path = rf.find("file").asString();
+    std::string out_path = rf.check("out", Value(file_path + ".bin")).asString();
+    std::string type = rf.check("type", Value("AE")).asString();
+    unsigned int threads = rf.check("threads", Value(0)).asInt32();
+
+    bool success = false;
+    if(type == ev::AE::tag)
+        success = convert<ev::AE>(file_path, out_path, threads);
+    else if(type == ev::IMUS::tag)
+        success = convert<ev::IMUS>(file_path, out_path, threads);
+    else if(type == ev::skinSample::tag)
+        success = convert<ev::skinSample>(file_path, out_path, threads);
+    else if(type == ev::earEvent::tag)
+        success = convert<ev::earEvent>(file_path, out_path, threads);
+    else
+        yError() << "Unknown event type" << type;
+
+    return success ? 0 : -1;
+}
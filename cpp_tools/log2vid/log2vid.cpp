@@ -21,6 +21,8 @@ void helpfunction()
     yInfo() << "--height <int> video height [720]";
     yInfo() << "--width <int> video width [1280]";
     yInfo() << "--vis <bool> show conversion process [false]";
+    yInfo() << "--lookahead <double> MB of events decoded ahead, 0 loads the whole log [0]";
+    yInfo() << "--threads <int> threads used to parse a loaded log, 0 uses all cores [1]";
     yInfo() << "METHOD: iso [default]";
     yInfo() << "--window <double> seconds of window length [0.5]";
     yInfo() << "METHOD: --tw";
@@ -70,8 +72,10 @@ int main(int argc, char* argv[])
     }    
 
     ev::offlineLoader<ev::AE> loader;
+    double lookahead = rf.check("lookahead", Value(0.0)).asFloat64();
+    unsigned int threads = rf.check("threads", Value(1)).asInt32();
     yInfo() << "Loading log file ... ";
-    if(!loader.load(file_path)) {
+    if(!(lookahead > 0.0 ? loader.stream(file_path, lookahead) : loader.load(file_path, DBL_MAX, threads))) {
         yError() << "Could not open log file";
         return -1;
     } else {
@@ -85,6 +89,11 @@ int main(int argc, char* argv[])
             cv::VideoWriter::fourcc('a','v','c','1'),
             fps*rate, res, true);
 
+    ev::metrics metrics;
+    ev::threadMetrics &m = metrics.thread("render");
+    ev::metricCounter &frames = m.counter("frames");
+    ev::metricHistogram &frame_ns = m.histogram("frame_ns");
+
     double virtual_timer = period;
     if(stampfile.is_open()) {
         stampfile >> virtual_timer;
@@ -97,6 +106,7 @@ int main(int argc, char* argv[])
         double duration = rf.check("window", Value(0.01)).asFloat64();
 
         while(loader.windowedReadTill(virtual_timer, duration) && !stampfile.eof()) {
+            ev::metricTimer timer(frame_ns);
             cv::Mat img = cv::Mat::zeros(res, CV_8UC3);
 
             for(auto &v : loader)
@@ -106,6 +116,7 @@ int main(int argc, char* argv[])
                 cv::waitKey(1);
             }
             dw << img;
+            frames.add();
             if(stampfile.is_open()) stampfile >> virtual_timer;
             else virtual_timer += period;
             std::cout << "\r" << std::fixed << std::setprecision(1) << virtual_timer << " s / " << loader.getLength() << " s       ";
@@ -117,6 +128,7 @@ int main(int argc, char* argv[])
         scarf.initialise(res, rf.check("block_size", Value(14)).asInt32(), rf.check("alpha", Value(1.0)).asFloat64(), rf.check("C", Value(0.3)).asFloat64());
 
         while(loader.incrementReadTill(virtual_timer) && !stampfile.eof()) {
+            ev::metricTimer timer(frame_ns);
             cv::Mat img, img8U;
 
             for(auto &v : loader)
@@ -131,6 +143,7 @@ int main(int argc, char* argv[])
                 cv::waitKey(1);
             }
             dw << img;
+            frames.add();
             if(stampfile.is_open()) stampfile >> virtual_timer;
             else virtual_timer += period;
             std::cout << "\r" << std::fixed << std::setprecision(1) << virtual_timer << " s / " << loader.getLength() << " s       ";
@@ -141,10 +154,10 @@ int main(int argc, char* argv[])
         eros.init(res.width, res.height, rf.check("block_size", Value(7)).asInt32(), rf.check("alpha", Value(0.3)).asFloat64());
 
         while(loader.incrementReadTill(virtual_timer) && !stampfile.eof()) {
+            ev::metricTimer timer(frame_ns);
             cv::Mat img, img8U;
 
-            for(auto &v : loader)
-                eros.update(v.x, v.y);
+            eros.update(loader.begin(), loader.end());
 
             eros.getSurface().copyTo(img8U);
             img8U = 255 - img8U;
@@ -155,6 +168,7 @@ int main(int argc, char* argv[])
                 cv::waitKey(1);
             }
             dw << img;
+            frames.add();
             if(stampfile.is_open()) stampfile >> virtual_timer;
             else virtual_timer += period;
             std::cout << "\r" << std::fixed << std::setprecision(1) << virtual_timer << " s / " << loader.getLength() << " s       ";
@@ -170,7 +184,7 @@ int main(int argc, char* argv[])
         cv::Mat base = cv::Mat::zeros(base_size, CV_8UC3);
 
         while(loader.windowedReadTill(virtual_timer, duration) && !stampfile.eof()) {
-            
+            ev::metricTimer timer(frame_ns);
             base.setTo(ev::white);
             int count = 0;
             for(auto &v : loader) count++;
@@ -183,6 +197,7 @@ int main(int argc, char* argv[])
             }
 
             dw << img;
+            frames.add();
             if(stampfile.is_open()) stampfile >> virtual_timer;
             else virtual_timer += period;
             std::cout << "\r" << std::fixed << std::setprecision(1) << virtual_timer << " s / " << loader.getLength() << " s       ";
@@ -191,6 +206,7 @@ int main(int argc, char* argv[])
         
     }
     std::cout << std::endl;
+    yInfo() << ev::metrics::summary(metrics.snapshot());
 
     dw.release();
 
@@ -35,8 +35,16 @@ void drawerInterface::run()
     static int sequence_number = 0;
     static double data_stamp = 0.0;
 
-    double nds = updateImage();
+    double nds;
+    if(metrics) {
+        queued->set(queuedEvents());
+        ev::metricTimer timer(*draw_ns);
+        nds = updateImage();
+    } else {
+        nds = updateImage();
+    }
     bool updated = (nds != data_stamp);
+    if(updated && frames) frames->add();
     data_stamp = nds;
 
     if(yarp_publish) {
@@ -69,6 +77,12 @@ bool drawerInterface::threadInit()
         yError() << "Drawer name not initialised";
         return false;
     }
+    if(metrics) {
+        ev::threadMetrics &m = metrics->thread(name);
+        frames = &m.counter("frames");
+        draw_ns = &m.histogram("draw_ns");
+        queued = &m.gauge("input_queue");
+    }
     if(yarp_publish)
         return image_port.open(name + "/image:o");
     else{
@@ -85,15 +99,30 @@ bool drawerInterface::threadInit()
 bool drawerInterfaceAE::initialise(const std::string &name, int height, int width, double window_size, bool yarp_publish, const std::string &remote) 
 {
     this->name = name;
-    std::stringstream ss;
-    ss << "/vFramer/" << (int)(yarp::os::Time::now())<< "/AE:i";
-    yarp::os::Time::delay(1);
-    this->portName = ss.str();
     this->sourceName = remote;
     this->yarp_publish = yarp_publish;
     this->img_size = {width, height};
     if(window_size > 0.0)
         this->window_size = window_size;
+
+    //drawers of the same source share the events of one port
+    if(input_source) {
+        this->portName = input_source->portName;
+        return input.share(input_source->input);
+    }
+
+    //the ring is named after the remote port, and is retried until the
+    //remote has opened it
+    if(shared) {
+        this->portName = remote;
+        connectToRemote();
+        return true;
+    }
+
+    std::stringstream ss;
+    ss << "/vFramer/" << (int)(yarp::os::Time::now())<< "/AE:i";
+    yarp::os::Time::delay(1);
+    this->portName = ss.str();
     bool success = input.open(portName);
     connectToRemote();
     return success;
@@ -101,10 +130,20 @@ bool drawerInterfaceAE::initialise(const std::string &name, int height, int widt
 
 void drawerInterfaceAE::connectToRemote() 
 {
+    if(input_source) return;
+    if(shared) {
+        if(!input.isRunning()) input.openShared(sourceName);
+        return;
+    }
     if(input.getInputCount() == 0 && !sourceName.empty())
         yarp::os::Network::connect(sourceName, portName, "fast_tcp");
 }
 
+void drawerInterfaceAE::shareInput(drawerInterface *source)
+{
+    input_source = dynamic_cast<drawerInterfaceAE *>(source);
+}
+
 void drawerInterfaceAE::threadRelease()
 {
     input.stop();
@@ -193,23 +232,9 @@ bool rtFlowDrawer::initialise(const std::string &name, int height, int width, do
 {
     // BLOCK, n, d, update#, max_dt, tolerance, SMOOTH
     zrt_flow.initialise({width, height}, block_size, max_n, con_d, con_upd, trip_tol, smooth);
-    sample = cv::Mat(height, width, CV_8UC3);
-    vt = std::thread([this]{updateFlowBuffer();});
     return drawerInterfaceAE::initialise(name, height, width, window_size, yarp_publish, remote);
 }
 
-void rtFlowDrawer::updateFlowBuffer()
-{
-    input.readPacket(true);
-    while(input.isRunning()) {
-        double tic = yarp::os::Time::now();
-        zrt_flow.update();
-        rate = ((yarp::os::Time::now() - tic) + rate)*0.5;
-        zrt_flow.makebgr().copyTo(sample);
-    }
-
-}
-
 double rtFlowDrawer::updateImage()
 {
 
@@ -219,25 +244,29 @@ double rtFlowDrawer::updateImage()
         canvas = white;
 
     ev::info inf = input.readAll(true);
-    for (auto v = input.begin(); v != input.end(); v++) {
+    for (auto v = input.begin(); v != input.end(); v++)
         zrt_flow.add(v->x, v->y, v.timestamp());
-        canvas.at<cv::Vec3b>(v->y, v->x) = sample.at<cv::Vec3b>(v->y, v->x);
-    }
 
-    return inf.timestamp;
-}
+    //the flow is only read here, so it is updated here too
+    double tic = yarp::os::Time::now();
+    zrt_flow.update();
+    rate = ((yarp::os::Time::now() - tic) + rate)*0.5;
+    cv::Mat sample = zrt_flow.makebgr();
 
-void rtFlowDrawer::threadRelease()
-{
-    input.stop();
-    vt.join();
+    for (auto &v : input)
+        canvas.at<cv::Vec3b>(v.y, v.x) = sample.at<cv::Vec3b>(v.y, v.x);
+
+    return inf.timestamp;
 }
 
 // EROS DRAW //
 // =========== //
 bool erosDrawer::initialise(const std::string &name, int height, int width, double window_size, bool yarp_publish, const std::string &remote)
 {
-    EROS_vis.init(width, height, this->kernelSize, this->decay);
+    //the common kernel size is fixed at compile time
+    if(kernelSize == 5) EROS_vis.reset(new ev::basicEROS<5>);
+    else EROS_vis.reset(new ev::EROS);
+    EROS_vis->init(width, height, this->kernelSize, this->decay);
     return drawerInterfaceAE::initialise(name, height, width, window_size, yarp_publish, remote);
 }
 
@@ -248,11 +277,10 @@ double erosDrawer::updateImage()
 
     ev::info inf = input.readAll(false);
 
-    for (auto &v : input)
-        EROS_vis.update(v.x, v.y);
+    EROS_vis->update(input.begin(), input.end());
 
     cv::Mat inter;
-    cv::medianBlur(EROS_vis.getSurface(), inter, 3);
+    cv::medianBlur(EROS_vis->getSurface(), inter, 3);
     cv::GaussianBlur(inter, inter, {3, 3}, -1);
     cv::normalize(inter, inter, 0, 512, CV_MINMAX);
     cv::cvtColor(inter, canvas, cv::COLOR_GRAY2BGR);
@@ -264,51 +292,38 @@ double erosDrawer::updateImage()
 bool scarfDrawer::initialise(const std::string &name, int height, int width, double window_size, bool yarp_publish, const std::string &remote)
 {
     scarf.initialise({width, height}, block, alpha, C);
-    vt = std::thread([this]{updateScarfRep();});
     return drawerInterfaceAE::initialise(name, height, width, window_size, yarp_publish, remote);
 }
 
-void scarfDrawer::updateScarfRep()
-{
-    input.readAll(true);
-    while (input.isRunning()) {
-
-        ev::info inf = input.readAll(true);
-        double tic = yarp::os::Time::now();
-        for (auto &v : input) scarf.update(v.x, v.y, v.p);
-        meas_t += yarp::os::Time::now() - tic;
-        meas_c += inf.count;
-        scarf_time = inf.timestamp;
-    }
-}
-
 double scarfDrawer::updateImage()
 {
     if(canvas.empty())
         canvas = cv::Mat(img_size, CV_8UC3);
 
+    //the SCARF is only read here, so it is updated here too
+    ev::info inf = input.readAll(false);
+    double tic = yarp::os::Time::now();
+    for (auto &v : input) scarf.update(v.x, v.y, v.p);
+    double toc = yarp::os::Time::now();
+
+    //measure the rate over each second
+    meas_t += toc - tic;
+    meas_c += inf.count;
+    if(toc > reset) {
+        if(meas_t > 0.0) rate = meas_c / meas_t;
+        meas_c = 0; meas_t = 0.0; reset = toc + 1.0;
+    }
+
     cv::Mat inter;
-    static std::stringstream ss;
     scarf.getSurface().convertTo(inter, CV_8U, 255);
     inter = 255 - inter;
     cv::cvtColor(inter, canvas, cv::COLOR_GRAY2BGR);
 
-    //update the maximum rate
-    static double mr = 0.0;
-    if(meas_c/meas_t > mr) {
-        mr = meas_c/meas_t;
-        ss.str("");
-        ss << std::fixed << std::setprecision(1) << (0.000001*mr) << " x10^6 v/s";
-    }
-    //reset the maximum rate every second
-    static int i = 0;
-    if(i++ * getPeriod() > 1) {
-        i = 0; meas_c = 0; meas_t = 0; mr = 0;
-    }
-
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << (0.000001*rate) << " x10^6 v/s";
     cv::putText(canvas, ss.str(), {30,30}, cv::FONT_HERSHEY_PLAIN, 2.0, {100, 100, 100});
 
-    return scarf_time;
+    return inf.timestamp;
 }
 
 //    CORNER    //
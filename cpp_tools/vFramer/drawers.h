@@ -31,6 +31,7 @@
 #include <event-driven/vis.h>
 #include <event-driven/algs.h>
 
+#include <memory>
 #include <map>
 #include <vector>
 #include <string>
@@ -48,10 +49,19 @@ protected:
     bool yarp_publish;
     yarp::os::BufferedPort< yarp::sig::FlexImage > image_port;
     double window_size;
+    bool shared{false};
+
+    //metrics of the drawing thread, if set
+    ev::metrics *metrics{nullptr};
+    ev::metricCounter *frames{nullptr};
+    ev::metricHistogram *draw_ns{nullptr};
+    ev::metricGauge *queued{nullptr};
 
     void run() override;
     bool threadInit() override;
     virtual double updateImage() = 0;
+    /// \brief events received but not yet drawn
+    virtual size_t queuedEvents() { return 0; }
 
 public:
 
@@ -60,6 +70,16 @@ public:
     virtual bool initialise(const std::string &name, int height, int width, double window_size, 
                         bool yarp_publish = false, const std::string &remote = "") = 0;
     virtual void connectToRemote() {};
+    /// \brief read the events received by source instead of opening another
+    /// input port. Call before initialise().
+    virtual void shareInput(drawerInterface *source) {};
+    /// \brief read the remote's shared memory ring (see
+    /// ev::window::openShared) instead of connecting a port to it. Call
+    /// before initialise().
+    void readShared(bool shared) { this->shared = shared; }
+    /// \brief record the frame rate and drawing time in metrics. Call
+    /// before start().
+    void setMetrics(ev::metrics *metrics) { this->metrics = metrics; }
 
 };
 
@@ -67,10 +87,13 @@ class drawerInterfaceAE : public drawerInterface
 {
 protected:
     ev::window<ev::AE> input;
+    drawerInterfaceAE *input_source{nullptr};
 public:
     virtual bool initialise(const std::string &name, int height, int width, double window_size, bool yarp_publish, const std::string &remote = "") override;
     void connectToRemote() override;
+    void shareInput(drawerInterface *source) override;
     void threadRelease() override;
+    size_t queuedEvents() override { return input.queuedEvents(); }
 };
 
 class greyDrawer : public drawerInterfaceAE {
@@ -97,17 +120,12 @@ protected:
     int smooth{3};
     double rate{0.0};
 
-    std::thread vt;
-    void updateFlowBuffer();
-
     ev::zrtFlow zrt_flow;
     double updateImage() override;
-    cv::Mat sample;
 
 public:
     rtFlowDrawer(int blk_sz, int N, int D, int con_upd, double tol, int smooth): block_size(blk_sz), max_n(N), con_d(D), con_upd(con_upd), trip_tol(tol), smooth(smooth), drawerInterfaceAE(){};
     bool initialise(const std::string &name, int height, int width, double window_size, bool yarp_publish, const std::string &remote = "") override;
-    void threadRelease() override;
 };
 
 class isoDrawer : public drawerInterfaceAE {
@@ -124,7 +142,7 @@ class erosDrawer : public drawerInterfaceAE {
 protected:
     int kernelSize {5};
     double decay {0.3};
-    ev::EROS EROS_vis;
+    std::unique_ptr<ev::surface> EROS_vis;
     double updateImage() override;
     
 public:
@@ -135,14 +153,14 @@ public:
 class scarfDrawer : public drawerInterfaceAE {
 protected:
     ev::SCARF scarf;
-    std::thread vt;
-    int meas_c{0};
+    //update rate over each second
+    double rate{0.0};
     double meas_t{0.0};
-    double scarf_time{0.0};
+    int meas_c{0};
+    double reset{0.0};
     int block{10};
     double alpha{1.0};
     double C{0.3};
-    void updateScarfRep();
     double updateImage() override;
     
 public:
@@ -33,6 +33,7 @@ class vFramerModule : public yarp::os::RFModule
 
 private:
     std::vector<drawerInterface *> publishers;
+    ev::metrics metrics;
 
 public:
 
@@ -42,7 +43,7 @@ public:
         if(rf.check("h") || rf.check("help"))
         {
             yInfo() << "vFramer - visualisation of event data";
-            yInfo() << "--<iso, grey, black, eros, corner, flow, scarf> : drawer style";
+            yInfo() << "--<iso, grey, black, eros, corner, flow, scarf> : drawer style(s), sharing one port per source";
             yInfo() << "--src[1-9] : connect to up to 10 remotes";
             yInfo() << "======================";
             yInfo() << "--name : global module name for ports";
@@ -51,6 +52,9 @@ public:
             yInfo() << "--fps : frame-rate cap of display";
             yInfo() << "--yarp_publish : publish over yarp port (calibration) instead of opencv frame";
             yInfo() << "--flip : flip the image x and y";
+            yInfo() << "--shared : read the shared memory rings of the remotes (same host) instead of connecting ports";
+            yInfo() << "--metrics : publish frame rate, drawing time and cpu metrics on <name>/metrics:o (default true)";
+            yInfo() << "--prometheus : also write the metrics to this Prometheus text file";
             yInfo() << "======================";
             yInfo() << "--eros_kernel : kernel size for eros view";
             yInfo() << "--eros_decay  : decay rate for eros view";
@@ -90,13 +94,17 @@ public:
         bool flip =
             rf.check("flip") && rf.check("flip", Value(true)).asBool();
 
-        std::string style = "iso";
-        if(rf.check("eros")) style = "eros";
-        if(rf.check("grey")||rf.check("gray")) style = "grey";
-        if(rf.check("black")) style = "black";
-        if(rf.check("corner")) style = "corner";
-        if(rf.check("scarf")) style = "scarf";
-        if(rf.check("flow")) style = "flow";
+        bool shared = rf.check("shared") && rf.check("shared", Value(true)).asBool();
+
+        std::vector<std::string> styles;
+        if(rf.check("iso")) styles.push_back("iso");
+        if(rf.check("eros")) styles.push_back("eros");
+        if(rf.check("grey")||rf.check("gray")) styles.push_back("grey");
+        if(rf.check("black")) styles.push_back("black");
+        if(rf.check("corner")) styles.push_back("corner");
+        if(rf.check("scarf")) styles.push_back("scarf");
+        if(rf.check("flow")) styles.push_back("flow");
+        if(styles.empty()) styles.push_back("iso");
 
         std::stringstream remote_id;
         for(int i = 0; i < 10; i++) 
@@ -106,31 +114,40 @@ public:
             if(!rf.check(remote_id.str())) continue; //srcN not supplied
 
             std::string remote = rf.find(remote_id.str()).asString();
-            
-            //add a drawer with the source
-            if(style=="iso") publishers.push_back(new isoDrawer);
-            if(style=="grey" || style=="gray") publishers.push_back(new greyDrawer);
-            if(style=="black") publishers.push_back(new blackDrawer);
-            if(style=="eros") publishers.push_back(new erosDrawer(rf.check("eros_kernel", Value(5)).asInt32(), 
-                                                                  rf.check("eros_decay", Value(0.3)).asFloat64()));
-            if(style=="corner") publishers.push_back(new cornerDrawer);
-            if(style=="scarf") publishers.push_back(new scarfDrawer(rf.check("block", Value(10)).asInt32(), 
-                                                                    rf.check("alpha", Value(1.0)).asFloat64(), 
-                                                                    rf.check("C", Value(0.2)).asFloat64()));
-            if(style=="flow") publishers.push_back(new rtFlowDrawer( rf.check("B", Value(40)).asInt32(),
-                                                                     rf.check("N", Value(40)).asInt32(),
-                                                                     rf.check("D", Value(2)).asInt32(),
-                                                                     rf.check("U", Value(20)).asInt32(),
-                                                                     rf.check("T", Value(0.5)).asFloat64(),
-                                                                     rf.check("S", Value(5)).asInt32()));
-
-            if(publishers.back()->initialise(remote, height, width, window_size, yarp_publish, remote))
-            {
-                yInfo() << "Drawing" << style << "from" << remote;
-            } else {
-                yError() << "[" << style << "DRAW ] failure";
+
+            //each style of the same source reads from the first one's port
+            drawerInterface *source = nullptr;
+            for(auto &style : styles) {
+
+                //add a drawer with the source
+                if(style=="iso") publishers.push_back(new isoDrawer);
+                if(style=="grey" || style=="gray") publishers.push_back(new greyDrawer);
+                if(style=="black") publishers.push_back(new blackDrawer);
+                if(style=="eros") publishers.push_back(new erosDrawer(rf.check("eros_kernel", Value(5)).asInt32(), 
+                                                                      rf.check("eros_decay", Value(0.3)).asFloat64()));
+                if(style=="corner") publishers.push_back(new cornerDrawer);
+                if(style=="scarf") publishers.push_back(new scarfDrawer(rf.check("block", Value(10)).asInt32(), 
+                                                                        rf.check("alpha", Value(1.0)).asFloat64(), 
+                                                                        rf.check("C", Value(0.2)).asFloat64()));
+                if(style=="flow") publishers.push_back(new rtFlowDrawer( rf.check("B", Value(40)).asInt32(),
+                                                                         rf.check("N", Value(40)).asInt32(),
+                                                                         rf.check("D", Value(2)).asInt32(),
+                                                                         rf.check("U", Value(20)).asInt32(),
+                                                                         rf.check("T", Value(0.5)).asFloat64(),
+                                                                         rf.check("S", Value(5)).asInt32()));
+
+                std::string drawer_name = styles.size() > 1 ? remote + "/" + style : remote;
+                if(source) publishers.back()->shareInput(source);
+                publishers.back()->readShared(shared);
+                if(publishers.back()->initialise(drawer_name, height, width, window_size, yarp_publish, remote))
+                {
+                    yInfo() << "Drawing" << style << "from" << remote;
+                } else {
+                    yError() << "[" << style << "DRAW ] failure";
+                }
+                publishers.back()->setPeriod(period);
+                if(!source) source = publishers.back();
             }
-            publishers.back()->setPeriod(period);
         }
 
         if(publishers.empty()) {
@@ -138,6 +155,13 @@ public:
             return false;
         }
 
+        if(rf.check("metrics", Value(true)).asBool()) {
+            if(!metrics.open(getName(), rf.check("prometheus", Value("")).asString()))
+                return false;
+            for(auto &pub : publishers)
+                pub->setMetrics(&metrics);
+        }
+
         yInfo() << "Starting publishers";
         for (auto pub_i = publishers.begin(); pub_i != publishers.end(); pub_i++)
         {
@@ -164,6 +188,7 @@ public:
     {
         for (auto pub_i = publishers.begin(); pub_i != publishers.end(); pub_i++)
             (*pub_i)->stop();
+        metrics.close();
 
         return true;
     }
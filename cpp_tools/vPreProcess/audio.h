@@ -36,7 +36,7 @@ public:
         p = &(output.prepare());
         return true;
     }
-    void process(ev::earEvent *datum)
+    void process(const ev::earEvent *datum)
     {
         if(p == nullptr) return;
         p->push_back(*datum);
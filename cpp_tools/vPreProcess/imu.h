@@ -36,7 +36,7 @@ public:
         p = &(output.prepare());
         return true;
     }
-    void process(ev::IMUS *datum)
+    void process(const ev::IMUS *datum)
     {
         if(p == nullptr) return;
         p->push_back(*datum);
@@ -62,7 +62,7 @@ public:
         return true;
     }
 
-    void process(ev::encoded *datum)
+    void process(const ev::encoded *datum)
     {
         static ev::skinSample ss;
         static bool expect_skin_value{false};
@@ -70,18 +70,18 @@ public:
         if(IS_SKSAMPLE(datum->data)) {
             if(p_samples) {
                 if(IS_SSA(datum->data)) { //this is sent first
-                    ss.address = *(ev::skinAE *)datum;
+                    ss.address = *(const ev::skinAE *)datum;
                     if(expect_skin_value) yError() << "mismatch skin samples";
                     expect_skin_value = true;
                 } else { //IS_SSV -> this is sent second
-                    ss.value = *(ev::skinValue *)datum;
+                    ss.value = *(const ev::skinValue *)datum;
                     if(expect_skin_value) p_samples->push_back(ss);
                     else yError() << "mismatch skin samples";
                     expect_skin_value = false;
                 }
             }
         } else {
-            if(p_events) p_events->push_back(*(ev::skinAE *)datum);
+            if(p_events) p_events->push_back(*(const ev::skinAE *)datum);
         }
 
     }
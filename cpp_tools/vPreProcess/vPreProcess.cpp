@@ -41,7 +41,7 @@ class vPreProcess : public yarp::os::RFModule, public yarp::os::Thread
 private:
 
     //output port for the vBottle with the new events computed by the module
-    ev::BufferedPort<ev::encoded> input;
+    ev::window<ev::encoded> input;
     yarp::os::BufferedPort< yarp::sig::Vector > rate_port;
 
     bool flag_vision;
@@ -65,6 +65,9 @@ private:
     double rate_t{0.0};
     int rate_n{0};
     bool flag_stats{false};
+    bool flag_trace{false};
+    ev::traceCollector tracer;
+    ev::metrics metrics;
     std::deque<double> plot_rates;
     void visualise_rate();
 
@@ -85,12 +88,14 @@ public:
 
 vPreProcess::~vPreProcess() 
 {
-    input.close();
+    input.stop();
     vision.close();
     imu.close();
     skin.close();
     audio.close();
     rate_port.close();
+    tracer.close();
+    metrics.close();
 }
 
 bool vPreProcess::configure(yarp::os::ResourceFinder &rf) 
@@ -99,6 +104,15 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
         yInfo() << "--local_stamp <bool>: overwrite the packet stamp with one"
                    "immediately as the packet arrives";
         yInfo() << "--stats <bool>: visualise event-rate stats";
+        yInfo() << "--max_lag <double>: drop data older than this (sec), 0 = never";
+        yInfo() << "--drop <string>: oldest, newest or decimate data once max_lag is reached";
+        yInfo() << "--async <int>: packets queued for a sending thread per output, 0 = send from the processing thread";
+        yInfo() << "--shared <string>: read the shared memory ring of this name (e.g. /zynqGrabber/AE:o) instead of <name>/AE:i,"
+                   " and send the vision outputs through shared memory rings";
+        yInfo() << "--shared_slots <int>: packets held by each shared memory output (default 128)";
+        yInfo() << "--trace <bool>: forward latency traces and publish the latency of each module on <name>/trace:o";
+        yInfo() << "--metrics <bool>: publish throughput, timing and cpu metrics on <name>/metrics:o (default true)";
+        yInfo() << "--prometheus <string>: also write the metrics to this Prometheus text file";
         yInfo() << "============";
         yInfo() << "--vision <bool>: open ports for vision";
         yInfo() << "--height <int>: image size";
@@ -136,6 +150,15 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
                       rf.check("local_stamp", Value(true)).asBool();
     flag_stats = rf.check("stats") &&
                  rf.check("stats", Value(true)).asBool();
+    double max_lag = rf.check("max_lag", Value(0.0)).asFloat64();
+    std::string drop = rf.check("drop", Value("oldest")).asString();
+    unsigned int async = rf.check("async", Value(0)).asInt32();
+    flag_trace = rf.check("trace") &&
+                 rf.check("trace", Value(true)).asBool();
+    bool flag_metrics = rf.check("metrics", Value(true)).asBool();
+    std::string prometheus = rf.check("prometheus", Value("")).asString();
+    std::string shared = rf.check("shared", Value("")).asString();
+    unsigned int shared_slots = rf.check("shared_slots", Value(128)).asInt32();
 
     //vision flags
     flag_vision = rf.check("vision") &&
@@ -171,6 +194,11 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
         vision.init_splits(output_stereo, output_polarities, output_corners);
         vision.init_flips(flipx, flipy, {width, height});
         vision.init_filter(t_temporal, t_spatial);
+        vision.init_async(async);
+        if(!shared.empty())
+            vision.init_shared(shared_slots);
+        if(flag_trace)
+            vision.init_trace(getName());
         if(undistort)
             vision.init_undistort(rf.find("camera_calibration_file").asString());
         if(!vision.open(getName()))
@@ -191,7 +219,31 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
             return false;
     
 
-    if (!input.open(getName("/AE:i"))) {
+    if(max_lag > 0.0) {
+        if(drop == "newest")
+            input.setDropPolicy(ev::DROP_NEWEST, max_lag);
+        else if(drop == "decimate")
+            input.setDropPolicy(ev::DROP_DECIMATE, max_lag);
+        else
+            input.setDropPolicy(ev::DROP_OLDEST, max_lag);
+        yInfo() << "Dropping" << drop << "data after" << max_lag << "seconds";
+    }
+
+    if(flag_trace) {
+        if(!tracer.open(getName("/trace:o")))
+            return false;
+        input.setTraceCollector(&tracer);
+    }
+
+    if(flag_metrics && !metrics.open(getName(), prometheus))
+        return false;
+
+    if(!shared.empty()) {
+        if(!input.openShared(shared)) {
+            yError() << "Could not read shared memory" << shared;
+            return false;
+        }
+    } else if (!input.open(getName("/AE:i"))) {
         yError() << "Could not open" << getName("/AE:i");
         return false;
     }
@@ -252,6 +304,13 @@ bool vPreProcess::updateModule() {
         rate_port.write();
     }
 
+    if(flag_vision) {
+        ev::writeInfo w = vision.write_stats();
+        if(w.packets)
+            yInfo() << w.packets << "packets waited" << (int)(w.mean_wait * 1e6) 
+                    << "us on average," << (int)(w.max_wait * 1e6) << "us at most, to be sent";
+    }
+
     if(flag_stats) {
         plot_rates.push_back(0.000001 * ((double)passed + (double)dropped) / getPeriod());
         while (plot_rates.size() > 40) plot_rates.pop_front();
@@ -259,11 +318,12 @@ bool vPreProcess::updateModule() {
     }
 
     //unprocessed data
-    static int puqs = 0;
-    int uqs = input.getPendingReads();
-    if(uqs || puqs) {
-        yInfo() << uqs << "unprocessed queues";
-        puqs = uqs;
+    static size_t pdropped = 0;
+    size_t ndropped = input.droppedEvents();
+    double lag = input.lag();
+    if(ndropped != pdropped || lag > getPeriod()) {
+        yInfo() << "lagging" << lag << "seconds," << ndropped - pdropped << "events dropped";
+        pdropped = ndropped;
     }
 
     return Thread::isRunning();
@@ -272,33 +332,53 @@ bool vPreProcess::updateModule() {
 
 void vPreProcess::run() {
 
+    ev::threadMetrics &m = metrics.thread("process");
+    ev::metricCounter &events = m.counter("events");
+    ev::metricCounter &bytes = m.counter("bytes");
+    ev::metricCounter &packets = m.counter("packets");
+    ev::metricHistogram &process_ns = m.histogram("process_ns");
+    ev::metricHistogram &send_ns = m.histogram("send_ns");
+    ev::metricGauge &queued = m.gauge("input_queue");
+    ev::metricGauge &send_queue = m.gauge("send_queue");
+
     Stamp localstamp;
     while (true) {
 
-        ev::packet<encoded> *q = input.read(true);
+        //const, so that shared memory packets are read in place
+        const ev::packet<encoded> *q = input.readPacket(true);
         if(!q) break;
+        events.add(q->size());
+        bytes.add(q->size() * sizeof(encoded));
+        packets.add();
+        queued.set(input.queuedPackets());
         if (use_local_stamp) localstamp.update();
         else localstamp = q->envelope();
 
         double tic = Time::now();
+        auto process_start = std::chrono::steady_clock::now();
+        vision.reserve(q->size());
         for(auto &v : *q) {
             if(IS_SKIN(v.data)) { //IS_SKIN
                 skin.process(&v);
             } else if(IS_IMU(v.data)) {
-                imu.process((ev::IMUS *)&v);
+                imu.process((const ev::IMUS *)&v);
             } else if(IS_AUDIO(v.data)) {
-                audio.process((ev::earEvent *)&v);
+                audio.process((const ev::earEvent *)&v);
             } else { //IS_VISION
-                vision.process((ev::AE *)&v, q->envelope().getTime());
+                vision.process(*(const ev::AE *)&v, q->envelope().getTime());
             }
         }
         rate_t += Time::now() - tic;
         rate_n += q->size();
+        process_ns.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - process_start).count());
 
-        vision.send(localstamp, q->duration());
+        ev::metricTimer timer(send_ns);
+        vision.send(localstamp, q->duration(), q);
         audio.send(localstamp, q->duration());
         imu.send(localstamp, q->duration());
         skin.send(localstamp, q->duration());
+        send_queue.set(vision.queued());
 
     }
 }
@@ -310,12 +390,16 @@ bool vPreProcess::interruptModule()
 
 void vPreProcess::onStop() 
 {
-    input.close();
-    vision.close();
+    //the thread can still be filling a shared memory slot, so the vision
+    //outputs are closed once it has stopped (~vPreProcess)
+    input.stop();
+    vision.interrupt();
     imu.close();
     skin.close();
     audio.close();
     rate_port.close();
+    tracer.close();
+    metrics.close();
 }
 
 int main(int argc, char *argv[]) {
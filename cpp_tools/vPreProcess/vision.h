@@ -48,8 +48,12 @@ private:
     
     //ports and packets
     bool opened{false};
+    unsigned int async_depth{0};
+    unsigned int shared_slots{0};
+    std::string trace_module;
     enum port_label { LEFT, RIGHT, LNEG, RNEG, LCOR, RCOR, STEREO};
     ev::BufferedPort<ev::AE> ports[7];
+    static constexpr size_t shared_slot_events = 8192;
     ev::packet<ev::AE> *packets[7] = 
         {nullptr,nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
 
@@ -104,6 +108,48 @@ public:
         }
     }
 
+    void init_trace(std::string module)
+    {
+        trace_module = module;
+        yInfo() << "[VISION]: tracing latency as" << module;
+    }
+
+    void init_async(unsigned int depth)
+    {
+        async_depth = depth;
+        if(async_depth) yInfo() << "[VISION]: sending up to" << depth << "queued packets from a separate thread";
+    }
+
+    void init_shared(unsigned int slots)
+    {
+        shared_slots = slots;
+        if(shared_slots) yInfo() << "[VISION]: sending through" << slots << "shared memory slots";
+    }
+
+    //how long packets waited to be sent, over all ports
+    ev::writeInfo write_stats()
+    {
+        ev::writeInfo all = {0, 0.0, 0.0};
+        for(int pl = LEFT; pl <= STEREO; pl++) {
+            if(!packets[pl]) continue;
+            ev::writeInfo w = ports[pl].writeStats();
+            if(!w.packets) continue;
+            all.mean_wait = (all.mean_wait * all.packets + w.mean_wait * w.packets) / (all.packets + w.packets);
+            all.packets += w.packets;
+            all.max_wait = std::max(all.max_wait, w.max_wait);
+        }
+        return all;
+    }
+
+    //packets waiting to be sent, over all ports
+    size_t queued()
+    {
+        size_t n = 0;
+        for(int pl = LEFT; pl <= STEREO; pl++)
+            if(packets[pl]) n += ports[pl].queued();
+        return n;
+    }
+
     void init_undistort(std::string calibration_file_path) 
     {
         if (calibrator.configure(calibration_file_path)) {
@@ -117,10 +163,19 @@ public:
 
     bool _openPort(const port_label label, const std::string name)
     {
-        if (!ports[label].open(name)) {
+        //larger packets are split across the shared memory slots
+        if (shared_slots) {
+            if (!ports[label].openSharedWriter(name, shared_slots, shared_slot_events)) {
+                yError() << "Could not open shared memory" << name;
+                return false;
+            }
+        } else if (!ports[label].open(name)) {
             yError() << "Could not open" << name;
             return false;
+        } else {
+            ports[label].setAsyncWrite(async_depth);
         }
+        ports[label].setTrace(trace_module);
         packets[label] = &(ports[label].prepare());
         return true;
     }
@@ -160,22 +215,29 @@ public:
         return true;
     }
 
-    void process(ev::AE *datum, double t)
+    /// \brief make sure every output can take n events without allocating
+    void reserve(size_t n)
+    {
+        for(int pl = LEFT; pl <= STEREO; pl++)
+            if(packets[pl]) packets[pl]->reserve(n);
+    }
+
+    void process(ev::AE datum, double t)
     {
         if(!opened) return;
         //flipping
-        if (flipx) datum->x = res.width  - datum->x - 1;
-        if (flipy) datum->y = res.height - datum->y - 1;
+        if (flipx) datum.x = res.width  - datum.x - 1;
+        if (flipy) datum.y = res.height - datum.y - 1;
 
         //salt-n-pepper filter
         if (apply_filter) {
-            if (datum->channel == ev::CAMERA_LEFT) {
-                if (!filter_left.check(datum->x, datum->y, datum->p, t)) {
+            if (datum.channel == ev::CAMERA_LEFT) {
+                if (!filter_left.check(datum.x, datum.y, datum.p, t)) {
                     v_dropped++;
                     return;
                 }
             } else {
-                if (!filter_right.check(datum->x, datum->y, datum->p, t)) {
+                if (!filter_right.check(datum.x, datum.y, datum.p, t)) {
                     v_dropped++;
                     return;
                 }
@@ -186,48 +248,57 @@ public:
 
         //undistortion and rectification
         if (undistort) {
-            int y = datum->y; int x = datum->x;
-            calibrator.sparseForwardTransform(datum->channel, y, x);
-            datum->y = y; datum->x = x;
+            int y = datum.y; int x = datum.x;
+            calibrator.sparseForwardTransform(datum.channel, y, x);
+            datum.y = y; datum.x = x;
         }
 
         //output to stereo combined stream
-        if (output_stereo) packets[STEREO]->push_back(*datum);
+        if (output_stereo) packets[STEREO]->push_back(datum);
 
         //output to corners stream
-        if (output_corners && datum->corner) {
-            if(datum->channel == ev::CAMERA_LEFT)
-                packets[LCOR]->push_back(*datum);
+        if (output_corners && datum.corner) {
+            if(datum.channel == ev::CAMERA_LEFT)
+                packets[LCOR]->push_back(datum);
             else
-                packets[RCOR]->push_back(*datum);
+                packets[RCOR]->push_back(datum);
         }
 
         //output stereo split streams (splitting also by polarity if needed)
-        if (output_polarities && datum->p == 0) {
-            if (datum->channel == ev::CAMERA_LEFT)
-                packets[LNEG]->push_back(*datum);
+        if (output_polarities && datum.p == 0) {
+            if (datum.channel == ev::CAMERA_LEFT)
+                packets[LNEG]->push_back(datum);
             else
-                packets[RNEG]->push_back(*datum);
+                packets[RNEG]->push_back(datum);
         } else {
-            if (datum->channel == ev::CAMERA_LEFT)
-                packets[LEFT]->push_back(*datum);
+            if (datum.channel == ev::CAMERA_LEFT)
+                packets[LEFT]->push_back(datum);
             else
-                packets[RIGHT]->push_back(*datum);
+                packets[RIGHT]->push_back(datum);
         }
     }
 
-    void send(yarp::os::Stamp stamp, double duration)
+    void send(yarp::os::Stamp stamp, double duration, const ev::packet<ev::encoded> *source = nullptr)
     {
         for(int pl = LEFT; pl <= STEREO; pl++) {
             if(packets[pl] && packets[pl]->size()) {
                 packets[pl]->duration(duration);
                 packets[pl]->envelope() = stamp;
+                if(source && !trace_module.empty())
+                    packets[pl]->inheritTrace(*source);
                 ports[pl].write();
                 packets[pl] = &(ports[pl].prepare());
             }
         }
     }
 
+    //wake a thread waiting for a free shared memory slot
+    void interrupt()
+    {
+        for(int pl = LEFT; pl <= STEREO; pl++)
+            ports[pl].interrupt();
+    }
+
     void close()
     {
         for(int pl = LEFT; pl <= STEREO; pl++) {
@@ -0,0 +1,228 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <event-driven/core.h>
+#include <event-driven/algs.h>
+#include <event-driven/vis.h>
+#include <yarp/os/ResourceFinder.h>
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \brief FNV-1a, used to compare the output of two runs
+inline uint64_t digest(const void *data, size_t bytes, uint64_t h = 14695981039346656037ULL)
+{
+    const uint8_t *d = (const uint8_t *)data;
+    for(size_t i = 0; i < bytes; i++)
+        h = (h ^ d[i]) * 1099511628211ULL;
+    return h;
+}
+
+inline uint64_t digest(const cv::Mat &m, uint64_t h = 14695981039346656037ULL)
+{
+    for(int r = 0; r < m.rows; r++)
+        h = digest(m.ptr(r), m.cols * m.elemSize(), h);
+    return h;
+}
+
+/// \brief one algorithm of the replay chain. Stages receive the batches of
+/// events in order, timed by event time only, so a replay is repeatable.
+class replayStage
+{
+public:
+
+    virtual ~replayStage() {}
+
+    /// \brief process a batch whose final event occurred at time t (see
+    /// ev::soa_batch::time). Filters remove events from the batch.
+    virtual void process(ev::soa_batch &batch, double t) = 0;
+
+    /// \brief called once per replay period, after the batch, with the time
+    /// of the end of the period
+    virtual void step(double t) { (void)t; }
+
+    /// \brief a digest of the stage output
+    virtual uint64_t state() = 0;
+};
+
+class filterStage : public replayStage
+{
+    ev::vNoiseFilter filter;
+    uint64_t h{14695981039346656037ULL};
+
+public:
+
+    filterStage(int width, int height, double t_spatial, double t_temporal)
+    {
+        filter.initialise(width, height);
+        if(t_spatial > 0.0) filter.use_spatial_filter(t_spatial);
+        if(t_temporal > 0.0) filter.use_temporal_filter(t_temporal);
+    }
+
+    void process(ev::soa_batch &batch, double t) override
+    {
+        filter.check(batch, t);
+        h = digest(batch.x.data(), batch.size() * sizeof(batch.x[0]), h);
+        h = digest(batch.y.data(), batch.size() * sizeof(batch.y[0]), h);
+        h = digest(batch.p.data(), batch.size() * sizeof(batch.p[0]), h);
+    }
+
+    uint64_t state() override { return h; }
+};
+
+template <typename S>
+class surfaceStage : public replayStage
+{
+    S surface;
+
+public:
+
+    surfaceStage(int width, int height, int kernel_size, double parameter)
+    {
+        surface.init(width, height, kernel_size, parameter);
+    }
+
+    void process(ev::soa_batch &batch, double t) override
+    {
+        surface.update(batch, t);
+    }
+
+    uint64_t state() override { return digest(surface.getSurface()); }
+};
+
+class scarfStage : public replayStage
+{
+    ev::SCARF scarf;
+
+public:
+
+    scarfStage(int width, int height, int block_size, double alpha, double C)
+    {
+        scarf.initialise({width, height}, block_size, alpha, C);
+    }
+
+    void process(ev::soa_batch &batch, double t) override
+    {
+        (void)t;
+        scarf.update(batch);
+    }
+
+    uint64_t state() override { return digest(scarf.getSurface()); }
+};
+
+class flowStage : public replayStage
+{
+    ev::zrtFlow flow;
+
+public:
+
+    flowStage(int width, int height)
+    {
+        //the vFramer defaults
+        flow.initialise({width, height}, 40, 80, 2, 20, 0.125, 3);
+    }
+
+    void process(ev::soa_batch &batch, double t) override
+    {
+        for(size_t i = 0; i < batch.size(); i++)
+            flow.add(batch.x[i], batch.y[i], batch.time(i, t));
+    }
+
+    void step(double t) override
+    {
+        flow.update(t);
+    }
+
+    uint64_t state() override { return digest(flow.makebgr()); }
+};
+
+class cornerStage : public replayStage
+{
+    ev::corner_detector detector;
+    std::vector<ev::AE> events;
+    std::deque<ev::AE> corners;
+    uint64_t h{14695981039346656037ULL};
+
+public:
+
+    cornerStage(int width, int height)
+    {
+        //the Harris response is refreshed every period instead of by a thread
+        detector.initialise(height, width, 14, false);
+    }
+
+    void process(ev::soa_batch &batch, double t) override
+    {
+        (void)t;
+        events.resize(batch.size());
+        if(events.empty()) return;
+        batch.pack(events.data());
+        corners.clear();
+        detector.detect(events.begin(), events.end(), corners);
+        for(auto &c : corners)
+            h = digest(&c, sizeof(c), h);
+    }
+
+    void step(double t) override
+    {
+        (void)t;
+        detector.refresh();
+    }
+
+    uint64_t state() override { return h; }
+};
+
+/// \brief a surface stage, with the common kernel sizes fixed at compile time
+template <typename S5, typename S7, typename S>
+inline replayStage *makeSurfaceStage(int width, int height, int kernel, double parameter)
+{
+    if(kernel == 5) return new surfaceStage<S5>(width, height, kernel, parameter);
+    if(kernel == 7) return new surfaceStage<S7>(width, height, kernel, parameter);
+    return new surfaceStage<S>(width, height, kernel, parameter);
+}
+
+/// \brief the stage called name, configured from rf, or nullptr
+inline std::unique_ptr<replayStage> makeStage(const std::string &name, int width, int height, yarp::os::ResourceFinder &rf)
+{
+    using yarp::os::Value;
+    int kernel = rf.check("kernel", Value(7)).asInt32();
+    double parameter = rf.check("parameter", Value(0.3)).asFloat64();
+
+    std::unique_ptr<replayStage> s;
+    if(name == "filter")
+        s.reset(new filterStage(width, height, rf.check("filter_s", Value(0.01)).asFloat64(),
+                                rf.check("filter_t", Value(0.0)).asFloat64()));
+    else if(name == "eros")  s.reset(makeSurfaceStage<ev::basicEROS<5>, ev::basicEROS<7>, ev::EROS>(width, height, kernel, parameter));
+    else if(name == "lazyeros") s.reset(new surfaceStage<ev::lazyEROS>(width, height, kernel, parameter));
+    else if(name == "tos")   s.reset(makeSurfaceStage<ev::basicTOS<5>, ev::basicTOS<7>, ev::TOS>(width, height, kernel, parameter));
+    else if(name == "sits")  s.reset(makeSurfaceStage<ev::basicSITS<5>, ev::basicSITS<7>, ev::SITS>(width, height, kernel, parameter));
+    else if(name == "pim")   s.reset(new surfaceStage<ev::PIM>(width, height, kernel, parameter));
+    else if(name == "sae")   s.reset(new surfaceStage<ev::SAE>(width, height, kernel, parameter));
+    else if(name == "bin")   s.reset(new surfaceStage<ev::BIN>(width, height, kernel, parameter));
+    else if(name == "scarf")
+        s.reset(new scarfStage(width, height, rf.check("block_size", Value(14)).asInt32(),
+                               rf.check("alpha", Value(1.0)).asFloat64(), rf.check("C", Value(0.3)).asFloat64()));
+    else if(name == "flow")    s.reset(new flowStage(width, height));
+    else if(name == "corners") s.reset(new cornerStage(width, height));
+    return s;
+}
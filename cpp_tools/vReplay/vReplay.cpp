@@ -0,0 +1,225 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <yarp/os/all.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "stages.h"
+
+using yarp::os::Value;
+
+void helpfunction()
+{
+    yInfo() << "USAGE:";
+    yInfo() << "--file <string> logfile or binary recording path";
+    yInfo() << "--chain <string> comma separated stages [filter,eros,scarf,flow]";
+    yInfo() << "    filter, eros, lazyeros, tos, sits, pim, sae, bin, scarf, flow, corners";
+    yInfo() << "--height <int> sensor height [480]";
+    yInfo() << "--width <int> sensor width [640]";
+    yInfo() << "--period <double> seconds of event time per step [0.01]";
+    yInfo() << "--seconds <double> only replay this many seconds of the log [all]";
+    yInfo() << "--lookahead <double> MB of events decoded ahead, 0 loads the whole log [64]";
+    yInfo() << "--threads <int> threads used to parse a loaded log, 0 uses all cores [1]";
+    yInfo() << "--digest_period <double> print the stage digests every this many seconds, 0 = at the end [0]";
+    yInfo() << "STAGE PARAMETERS:";
+    yInfo() << "--filter_s <double> spatial filter time window [0.01]";
+    yInfo() << "--filter_t <double> temporal filter time window [0]";
+    yInfo() << "--kernel <int> surface kernel size [7]";
+    yInfo() << "--parameter <double> surface parameter (e.g. EROS decay) [0.3]";
+    yInfo() << "--block_size <int> SCARF array dimension [14]";
+    yInfo() << "--alpha <double> SCARF events accumulation factor [1.0]";
+    yInfo() << "--C <double> SCARF intensity [0.3]";
+}
+
+struct stageInfo
+{
+    std::string name;
+    std::unique_ptr<replayStage> stage;
+    ev::metricHistogram *step_ns;
+    uint64_t events_in{0};
+    uint64_t events_out{0};
+    double seconds{0.0};
+};
+
+static std::string hex(uint64_t h)
+{
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << h;
+    return ss.str();
+}
+
+static void printDigests(double t, std::vector<stageInfo> &chain)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3) << t << " s:";
+    for(auto &s : chain)
+        ss << " " << s.name << "=" << hex(s.stage->state());
+    yInfo() << ss.str();
+}
+
+int main(int argc, char* argv[])
+{
+    using clock = std::chrono::steady_clock;
+
+    yarp::os::ResourceFinder rf;
+    rf.configure(argc, argv);
+    if(rf.check("help") || rf.check("h")) {
+        helpfunction();
+        return 0;
+    }
+
+    if(!rf.check("file")) {
+        yError() << "Please provide path to .log containing events";
+        helpfunction();
+        return -1;
+    }
+    std::string file_path = rf.find("file").asString();
+
+    int width = rf.check("width", Value(640)).asInt32();
+    int height = rf.check("height", Value(480)).asInt32();
+    double period = rf.check("period", Value(0.01)).asFloat64();
+    double seconds = rf.check("seconds", Value(-1.0)).asFloat64();
+    double digest_period = rf.check("digest_period", Value(0.0)).asFloat64();
+    if(period <= 0.0) {
+        yError() << "--period must be positive";
+        return -1;
+    }
+
+    ev::metrics metrics;
+    ev::threadMetrics &m = metrics.thread("replay");
+    ev::metricHistogram &read_ns = m.histogram("read_ns");
+
+    std::vector<stageInfo> chain;
+    std::stringstream chain_list(rf.check("chain", Value("filter,eros,scarf,flow")).asString());
+    std::string name;
+    while(std::getline(chain_list, name, ',')) {
+        stageInfo s;
+        s.name = name;
+        s.stage = makeStage(name, width, height, rf);
+        if(!s.stage) {
+            yError() << "Unknown stage" << name;
+            helpfunction();
+            return -1;
+        }
+        s.step_ns = &m.histogram(name + "_ns");
+        chain.push_back(std::move(s));
+    }
+
+    ev::offlineLoader<ev::AE> loader;
+    double lookahead = rf.check("lookahead", Value(64.0)).asFloat64();
+    unsigned int threads = rf.check("threads", Value(1)).asInt32();
+    yInfo() << "Loading log file ... ";
+    if(!(lookahead > 0.0 ? loader.stream(file_path, lookahead, seconds) : loader.load(file_path, seconds, threads))) {
+        yError() << "Could not open log file";
+        return -1;
+    } else {
+        yInfo() << loader.getinfo();
+    }
+
+    //event time, relative to the start of the log, is the only clock
+    loader.synchroniseRealtimeRead(0.0);
+    double start_time = loader.getStartTime();
+
+    std::vector<ev::AE> events;
+    ev::soa_batch batch;
+    uint64_t total_events = 0, out_of_bounds = 0;
+    double read_seconds = 0.0;
+    double next_digest = digest_period;
+    double next_progress = 1.0;
+    double virtual_timer = period;
+
+    auto replay_start = clock::now();
+    while(loader.incrementReadTill(virtual_timer)) {
+
+        //gather the events of the step, dropping any outside the sensor
+        auto tic = clock::now();
+        events.clear();
+        double t = virtual_timer;
+        if(loader.begin() != loader.end()) {
+            t = loader.end().timestamp() - start_time;
+            for(auto &v : loader) {
+                if(v.x >= width || v.y >= height) { out_of_bounds++; continue; }
+                events.push_back(v);
+            }
+        }
+        batch.unpack(events.data(), events.size());
+        total_events += events.size();
+        auto toc = clock::now();
+        read_seconds += std::chrono::duration<double>(toc - tic).count();
+        read_ns.record(std::chrono::duration_cast<std::chrono::nanoseconds>(toc - tic).count());
+
+        //each stage processes the batch left by the previous one
+        for(auto &s : chain) {
+            tic = clock::now();
+            s.events_in += batch.size();
+            s.stage->process(batch, t);
+            s.stage->step(virtual_timer);
+            s.events_out += batch.size();
+            toc = clock::now();
+            s.seconds += std::chrono::duration<double>(toc - tic).count();
+            s.step_ns->record(std::chrono::duration_cast<std::chrono::nanoseconds>(toc - tic).count());
+        }
+
+        if(digest_period > 0.0 && virtual_timer >= next_digest) {
+            printDigests(virtual_timer, chain);
+            next_digest += digest_period;
+        }
+        if(virtual_timer >= next_progress) {
+            std::cout << "\r" << std::fixed << std::setprecision(1) << virtual_timer << " s / " << loader.getLength() << " s       ";
+            std::cout.flush();
+            next_progress += 1.0;
+        }
+        virtual_timer += period;
+    }
+    double wall = std::chrono::duration<double>(clock::now() - replay_start).count();
+    double data = virtual_timer - period;
+    std::cout << std::endl;
+
+    if(out_of_bounds)
+        yWarning() << out_of_bounds << "events outside of" << width << "x" << height << "were dropped";
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << std::endl << std::left << std::setw(10) << "stage" << std::right
+       << std::setw(12) << "events in" << std::setw(12) << "events out"
+       << std::setw(10) << "ns/event" << std::setw(10) << "Mev/s" << "  digest" << std::endl;
+    ss << std::left << std::setw(10) << "read" << std::right << std::setw(12) << total_events
+       << std::setw(12) << total_events
+       << std::setw(10) << (total_events ? read_seconds * 1e9 / total_events : 0.0)
+       << std::setw(10) << (read_seconds > 0.0 ? total_events * 1e-6 / read_seconds : 0.0) << std::endl;
+    uint64_t combined = 14695981039346656037ULL;
+    for(auto &s : chain) {
+        uint64_t h = s.stage->state();
+        combined = digest(&h, sizeof(h), combined);
+        ss << std::left << std::setw(10) << s.name << std::right << std::setw(12) << s.events_in
+           << std::setw(12) << s.events_out
+           << std::setw(10) << (s.events_in ? s.seconds * 1e9 / s.events_in : 0.0)
+           << std::setw(10) << (s.seconds > 0.0 ? s.events_in * 1e-6 / s.seconds : 0.0)
+           << "  " << hex(h) << std::endl;
+    }
+    ss << std::endl << total_events << " events, " << data << " s of data replayed in " << wall << " s ("
+       << (wall > 0.0 ? data / wall : 0.0) << "x real-time, "
+       << (wall > 0.0 ? total_events * 1e-6 / wall : 0.0) << " M events/s)" << std::endl;
+    ss << "digest " << hex(combined);
+    yInfo() << ss.str();
+    yInfo() << ev::metrics::summary(metrics.snapshot());
+
+    return 0;
+}
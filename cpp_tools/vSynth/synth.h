@@ -0,0 +1,349 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <event-driven/core.h>
+#include <yarp/os/Log.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// \brief splitmix64. Integer only, so a seed gives the same stream on any
+/// machine, and fast enough to draw several numbers per event at 50M ev/s.
+class synthRandom
+{
+private:
+    uint64_t state;
+
+    static inline uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+
+    /// \brief an independent stream for each (seed, index), e.g. one per
+    /// packet, so a packet does not depend on how the previous ones were made
+    synthRandom(uint64_t seed, uint64_t index = 0) : state(mix(seed) ^ mix(index + 0x9e3779b97f4a7c15ULL)) {}
+
+    inline uint64_t next()
+    {
+        return mix(state += 0x9e3779b97f4a7c15ULL);
+    }
+
+    inline uint32_t next32()
+    {
+        return (uint32_t)(next() >> 32);
+    }
+
+    /// \brief an integer in [0, n)
+    inline int below(uint32_t n)
+    {
+        return (int)(((uint64_t)next32() * n) >> 32);
+    }
+};
+
+/// \brief generates the event stream of a synthetic sensor, packet by packet.
+/// Visual events come from a weighted mix of scene models, with IMU samples
+/// and skin events interleaved in time as they would be in the zynqGrabber
+/// output.
+class synthGenerator
+{
+public:
+
+    enum model { BAR, DISK, NOISE, HOT, STORM, N_MODELS };
+
+    struct parameters {
+        int width{640};
+        int height{480};
+        double rate{1e6};           //visual events/s outside of storms
+        double bar_speed{0.0};      //pixels/s, 0 = cross the sensor in 0.5 s
+        int bar_width{0};           //pixels, 0 = width / 20
+        double disk_rps{1.0};       //revolutions/s
+        int hot_pixels{20};
+        double storm_gain{10.0};    //rate multiplier during a storm
+        double storm_period{1.0};   //seconds between storms
+        double storm_length{0.05};  //seconds
+        int disparity{-1};          //stereo disparity in pixels, < 0 = mono
+        double imu_rate{0.0};       //IMU samples/s
+        double skin_rate{0.0};      //skin events/s
+        uint64_t seed{1};
+    };
+
+private:
+
+    static constexpr int imu_sensors = 10;
+    static constexpr int table_size = 4096;
+    static constexpr uint32_t skin_flag = 1 << 15;   //IS_SKIN in skinAE::constant
+    static constexpr unsigned int imu_flag = 0x02;    //IS_IMU in IMUS::_r2
+
+    parameters params;
+    double weights[N_MODELS]{0};
+    bool storms{false};
+
+    //pre-computed so no trigonometry is needed per event
+    std::vector<float> cos_table, sin_table;
+    std::vector<ev::AE> hot;
+
+    inline ev::AE stamped(double t)
+    {
+        ev::AE v{};
+#if ENABLE_TS
+        v.ts = (uint64_t)(t * ev::vtsscaler) & ev::max_stamp;
+#endif
+        return v;
+    }
+
+    //left or right camera, with the right image shifted by the disparity
+    inline void place(ev::AE &v, int x, int y, bool right)
+    {
+        if(params.disparity >= 0 && right) {
+            v.channel = 1;
+            x -= params.disparity;
+        }
+        while(x < 0) x += params.width;
+        while(x >= params.width) x -= params.width;
+        v.x = x; v.y = y;
+    }
+
+    //an integer in [0, n) from 32 random bits
+    static inline int scale(uint32_t bits, uint32_t n)
+    {
+        return (int)(((uint64_t)bits * n) >> 32);
+    }
+
+    void imuSample(ev::AE *&out, double t, synthRandom &r)
+    {
+        //a slow wobble on top of gravity
+        double w = 2.0 * M_PI * 0.5;
+        double s = std::sin(w * t), c = std::cos(w * t);
+        int values[imu_sensors] = {
+            (int)(2000 * s), (int)(2000 * c), 16384,      //accelerometer
+            (int)(500 * c), (int)(-500 * s), 0,           //gyroscope
+            2500,                                         //temperature
+            500, -300, 800 };                             //magnetometer
+        for(int i = 0; i < imu_sensors; i++) {
+            ev::IMUS v{};
+#if ENABLE_TS
+            v.ts = (uint64_t)(t * ev::vtsscaler) & ev::max_stamp;
+#endif
+            v.value = values[i] + (i == 6 ? 0 : r.below(64) - 32);
+            v.sensor = i;
+            v._r2 = imu_flag;
+            std::memcpy(out++, &v, sizeof(v));
+        }
+    }
+
+    void skinEvent(ev::AE *&out, double t, synthRandom &r)
+    {
+        ev::skinAE v{};
+#if ENABLE_TS
+        v.ts = (uint64_t)(t * ev::vtsscaler) & ev::max_stamp;
+#endif
+        v.polarity = r.next32() & 1;
+        v.taxel = r.below(16);
+        v.device = r.below(16);
+        v.constant = skin_flag;
+        std::memcpy(out++, &v, sizeof(v));
+    }
+
+    //the index of the first sample at or after t. Consecutive packets share
+    //the same boundary value, so each sample falls in exactly one packet.
+    static inline uint64_t first(double rate, double t)
+    {
+        return rate > 0.0 ? (uint64_t)std::ceil(t * rate) : 0;
+    }
+
+    //number of whole events in [t0, t1) at rate, so that no fraction is
+    //lost between packets
+    static inline size_t count(double rate, double t0, double t1)
+    {
+        return first(rate, t1) - first(rate, t0);
+    }
+
+    inline bool inStorm(double t) const
+    {
+        return storms && std::fmod(t, params.storm_period) < params.storm_length;
+    }
+
+public:
+
+    static_assert(sizeof(ev::IMUS) == sizeof(ev::AE) && sizeof(ev::skinAE) == sizeof(ev::AE),
+                  "IMU and skin words must share the AE stream");
+
+    /// \brief scenario is a comma separated list of models with optional
+    /// weights, e.g. "bar:0.8,noise:0.2". storm takes no weight: it adds
+    /// bursts of uniform events on top of the other models.
+    bool initialise(const parameters &p, const std::string &scenario)
+    {
+        params = p;
+        if(params.width < 1 || params.width > 2048 || params.height < 1 || params.height > 1024) {
+            yError() << "Resolution must be within 2048x1024 to fit an AE";
+            return false;
+        }
+        if(params.bar_speed <= 0.0) params.bar_speed = params.width / 0.5;
+        if(params.bar_width <= 0) params.bar_width = std::max(params.width / 20, 2);
+        if(params.storm_period <= 0.0) params.storm_period = 1.0;
+
+        std::stringstream ss(scenario);
+        std::string item;
+        double total = 0.0;
+        while(std::getline(ss, item, ',')) {
+            std::string name = item.substr(0, item.find(':'));
+            double weight = 1.0;
+            if(item.find(':') != std::string::npos)
+                weight = std::atof(item.substr(item.find(':') + 1).c_str());
+            if(name == "bar")        weights[BAR] += weight;
+            else if(name == "disk")  weights[DISK] += weight;
+            else if(name == "noise") weights[NOISE] += weight;
+            else if(name == "hot")   weights[HOT] += weight;
+            else if(name == "storm") { storms = true; continue; }
+            else {
+                yError() << "Unknown scenario model" << name << "(bar, disk, noise, hot, storm)";
+                return false;
+            }
+            total += weight;
+        }
+        if(total <= 0.0 && !storms) {
+            yError() << "The scenario has no models";
+            return false;
+        }
+        for(auto &w : weights) w = total > 0.0 ? w / total : 0.0;
+        if(total <= 0.0) params.rate = 0.0;
+
+        cos_table.resize(table_size);
+        sin_table.resize(table_size);
+        for(int i = 0; i < table_size; i++) {
+            cos_table[i] = (float)std::cos(2.0 * M_PI * i / table_size);
+            sin_table[i] = (float)std::sin(2.0 * M_PI * i / table_size);
+        }
+
+        synthRandom r(params.seed, UINT64_MAX);
+        hot.resize(std::max(params.hot_pixels, 1));
+        for(auto &h : hot) {
+            h = stamped(0.0);
+            place(h, r.below(params.width), r.below(params.height), r.next32() & 1);
+        }
+
+        return true;
+    }
+
+    /// \brief the largest number of words generate() adds for [t0, t1)
+    size_t capacity(double t0, double t1) const
+    {
+        double rate = params.rate * (storms ? 1.0 + params.storm_gain : 1.0);
+        return count(rate, t0, t1) + count(params.imu_rate, t0, t1) * imu_sensors
+               + count(params.skin_rate, t0, t1) + 1;
+    }
+
+    /// \brief append the events in [t0, t1) to p, in time order. The events
+    /// only depend on the parameters, the seed and the packet index.
+    void generate(ev::packet<ev::AE> &p, double t0, double t1, uint64_t index)
+    {
+        synthRandom r(params.seed, index);
+
+        size_t start = p.size();
+        p.resize(start + capacity(t0, t1));
+        ev::AE *out = p.begin() + start;
+
+        //visual events are spaced evenly, with the models drawn per event
+        size_t n_base = count(params.rate, t0, t1);
+        size_t n_storm = inStorm(t0) ? count(params.rate * params.storm_gain, t0, t1) : 0;
+        size_t n = n_base + n_storm;
+        uint64_t threshold[N_MODELS];
+        double cumulative = 0.0;
+        for(int m = 0; m < N_MODELS; m++) {
+            double w = (m == STORM) ? (n ? (double)n_storm / n : 0.0)
+                                    : weights[m] * (n ? (double)n_base / n : 0.0);
+            cumulative += w;
+            threshold[m] = (uint64_t)(cumulative * 4294967296.0);
+        }
+        threshold[N_MODELS - 1] = UINT64_MAX;
+
+        double step = n ? (t1 - t0) / n : 0.0;
+        double bar_front = std::fmod(params.bar_speed * t0, (double)params.width);
+        double disk_phase = std::fmod(params.disk_rps * t0, 1.0);
+        int cx = params.width / 2, cy = params.height / 2;
+        int radius = std::max((int)(std::min(params.width, params.height) * 0.45), 1);
+        const int spoke = table_size / 32;
+
+        //IMU samples and skin events at their own fixed rates
+        uint64_t imu_k = first(params.imu_rate, t0), imu_end = first(params.imu_rate, t1);
+        uint64_t skin_k = first(params.skin_rate, t0), skin_end = first(params.skin_rate, t1);
+
+        for(size_t i = 0; i < n; i++) {
+            double t = t0 + i * step;
+            for(; imu_k < imu_end && imu_k / params.imu_rate <= t; imu_k++)
+                imuSample(out, imu_k / params.imu_rate, r);
+            for(; skin_k < skin_end && skin_k / params.skin_rate <= t; skin_k++)
+                skinEvent(out, skin_k / params.skin_rate, r);
+
+            //two draws per event: the model, polarity, camera and jitter
+            //from the first, the position from the second
+            uint64_t a = r.next(), b = r.next();
+            uint32_t u = (uint32_t)(a >> 32);
+            int m = 0;
+            while(u >= threshold[m]) m++;
+            bool right = (a >> 1) & 1;
+            int x = scale((uint32_t)(b >> 32), params.width);
+            int y = scale((uint32_t)b, params.height);
+
+            //built locally: writing the fields into the packet would make the
+            //compiler reload the parameters after every store
+            ev::AE v = stamped(t);
+            v.p = a & 1;
+            switch(m) {
+            case BAR: {
+                //positive leading edge, negative trailing edge
+                x = (int)(bar_front + params.bar_speed * (t - t0)) + (int)((a >> 2) & 1) - (int)((a >> 3) & 1);
+                if(!v.p) x -= params.bar_width;
+                place(v, x, y, right);
+                break; }
+            case DISK: {
+                //a spoke painted on a rotating disk
+                int angle = (int)((disk_phase + params.disk_rps * (t - t0)) * table_size);
+                if(!v.p) angle -= spoke;
+                angle &= table_size - 1;
+                int d = scale((uint32_t)b, radius);
+                place(v, cx + (int)(d * cos_table[angle]), cy + (int)(d * sin_table[angle]), right);
+                break; }
+            case HOT: {
+                int p = v.p;
+                v = hot[scale((uint32_t)b, hot.size())];
+#if ENABLE_TS
+                v.ts = (uint64_t)(t * ev::vtsscaler) & ev::max_stamp;
+#endif
+                v.p = p;
+                break; }
+            default: //NOISE and STORM
+                place(v, x, y, right);
+            }
+            *out++ = v;
+        }
+        for(; imu_k < imu_end; imu_k++) imuSample(out, imu_k / params.imu_rate, r);
+        for(; skin_k < skin_end; skin_k++) skinEvent(out, skin_k / params.skin_rate, r);
+
+        p.resize(out - p.begin());
+    }
+};
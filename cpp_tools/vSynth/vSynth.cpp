@@ -0,0 +1,221 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <yarp/os/all.h>
+#include <atomic>
+#include <chrono>
+
+#include "event-driven/core.h"
+#include "synth.h"
+
+using namespace ev;
+using namespace yarp::os;
+
+class vSynth : public RFModule, public Thread {
+
+private:
+
+    ev::BufferedPort<AE> output_port;
+    synthGenerator generator;
+    ev::metrics metrics;
+
+    double period{0.001};
+    double duration{0.0};
+    bool realtime{true};
+
+    std::atomic<int> counter_packets{0};
+    std::atomic<int> counter_events{0};
+    std::atomic<int> counter_late{0};
+
+public:
+
+    bool configure(yarp::os::ResourceFinder& rf) override
+    {
+        if(rf.check("h") || rf.check("help")) {
+            yInfo() << "Synthetic event stream for load testing without hardware";
+            yInfo() << "--name <str>\t: internal port name prefix (default /vSynth)";
+            yInfo() << "--width <int> --height <int>\t: sensor resolution (default 640 480)";
+            yInfo() << "--rate <double>\t: visual events per second (default 1e6)";
+            yInfo() << "--scenario <str>\t: models with optional weights, from bar, disk, noise, hot, storm (default bar:0.8,noise:0.2)";
+            yInfo() << "--seed <int>\t: the same seed gives the same stream (default 1)";
+            yInfo() << "--period <double>\t: seconds of data per packet (default 0.001)";
+            yInfo() << "--duration <double>\t: stop after this many seconds of data, 0 = never";
+            yInfo() << "--realtime <bool>\t: send packets at the rate of the data, otherwise as fast as possible (default true)";
+            yInfo() << "--bar_speed <double>\t: bar speed in pixels/s (default width / 0.5)";
+            yInfo() << "--bar_width <int>\t: bar width in pixels (default width / 20)";
+            yInfo() << "--disk_rps <double>\t: disk revolutions per second (default 1)";
+            yInfo() << "--hot_pixels <int>\t: number of hot pixels (default 20)";
+            yInfo() << "--storm_gain <double>\t: event rate multiplier during a storm (default 10)";
+            yInfo() << "--storm_period <double>\t: seconds between storms (default 1)";
+            yInfo() << "--storm_length <double>\t: seconds each storm lasts (default 0.05)";
+            yInfo() << "--stereo <int>\t: left and right cameras with this disparity in pixels";
+            yInfo() << "--imu <double>\t: IMU samples per second, 0 = none";
+            yInfo() << "--skin <double>\t: skin events per second, 0 = none";
+            yInfo() << "--compress <bool>\t: send compressed packets";
+            yInfo() << "--async <int>\t: packets queued for a sending thread, 0 = send from the generating thread";
+            yInfo() << "--trace <bool>\t: stamp packets for end-to-end latency tracing";
+            yInfo() << "--metrics <bool>\t: publish throughput, timing and cpu metrics on <name>/metrics:o (default true)";
+            yInfo() << "--prometheus <str>\t: also write the metrics to this Prometheus text file";
+            return false;
+        }
+
+        if(!yarp::os::Network::checkNetwork(2.0)) {
+            yError() << "Could not connect to YARP";
+            return false;
+        }
+
+        setName((rf.check("name", Value("/vSynth")).asString()).c_str());
+
+        synthGenerator::parameters params;
+        params.width = rf.check("width", Value(params.width)).asInt32();
+        params.height = rf.check("height", Value(params.height)).asInt32();
+        params.rate = rf.check("rate", Value(params.rate)).asFloat64();
+        params.bar_speed = rf.check("bar_speed", Value(params.bar_speed)).asFloat64();
+        params.bar_width = rf.check("bar_width", Value(params.bar_width)).asInt32();
+        params.disk_rps = rf.check("disk_rps", Value(params.disk_rps)).asFloat64();
+        params.hot_pixels = rf.check("hot_pixels", Value(params.hot_pixels)).asInt32();
+        params.storm_gain = rf.check("storm_gain", Value(params.storm_gain)).asFloat64();
+        params.storm_period = rf.check("storm_period", Value(params.storm_period)).asFloat64();
+        params.storm_length = rf.check("storm_length", Value(params.storm_length)).asFloat64();
+        params.disparity = rf.check("stereo", Value(-1)).asInt32();
+        params.imu_rate = rf.check("imu", Value(0.0)).asFloat64();
+        params.skin_rate = rf.check("skin", Value(0.0)).asFloat64();
+        params.seed = rf.check("seed", Value(1)).asInt64();
+        std::string scenario = rf.check("scenario", Value("bar:0.8,noise:0.2")).asString();
+        if(!generator.initialise(params, scenario))
+            return false;
+
+        period = rf.check("period", Value(0.001)).asFloat64();
+        duration = rf.check("duration", Value(0.0)).asFloat64();
+        realtime = rf.check("realtime", Value(true)).asBool();
+        if(period <= 0.0) {
+            yError() << "--period must be positive";
+            return false;
+        }
+
+        output_port.setCompression(rf.check("compress") &&
+                                   rf.check("compress", Value(true)).asBool());
+        output_port.setAsyncWrite(rf.check("async", Value(0)).asInt32());
+        if(rf.check("trace") && rf.check("trace", Value(true)).asBool())
+            output_port.setTrace(getName());
+
+        if(!output_port.open(getName("/AE:o"))) {
+            yError() << "Could not open output port";
+            return false;
+        }
+
+        if(rf.check("metrics", Value(true)).asBool() &&
+           !metrics.open(getName(), rf.check("prometheus", Value("")).asString()))
+            return false;
+
+        yInfo() << "[" << params.width << "x" << params.height << "]" << scenario
+                << "at" << params.rate * 1e-6 << "M events/s, seed" << (int)params.seed;
+
+        return Thread::start();
+    }
+
+    double getPeriod() override
+    {
+        return 1.0;
+    }
+
+    bool interruptModule() override
+    {
+        return Thread::stop();
+    }
+
+    void onStop() override
+    {
+        output_port.close();
+        metrics.close();
+    }
+
+    bool updateModule() override
+    {
+        yInfo() << counter_packets.exchange(0) << "packets and"
+                << (counter_events.exchange(0) * 0.001) << "k events sent per second";
+        int late = counter_late.exchange(0);
+        if(late)
+            yWarning() << late << "packets sent later than real-time";
+
+        return Thread::isRunning();
+    }
+
+    //generate each packet of data and send it once its data time has passed
+    void run() override
+    {
+        ev::threadMetrics &tm = metrics.thread("generate");
+        ev::metricCounter &events = tm.counter("events");
+        ev::metricCounter &bytes = tm.counter("bytes");
+        ev::metricCounter &packets = tm.counter("packets");
+        ev::metricHistogram &generate_ns = tm.histogram("generate_ns");
+        ev::metricHistogram &send_ns = tm.histogram("send_ns");
+        ev::metricGauge &lag_us = tm.gauge("lag_us");
+        ev::metricGauge &queued = tm.gauge("send_queue");
+
+        double start = yarp::os::Time::now();
+        for(uint64_t i = 0; !Thread::isStopping(); i++) {
+
+            double t0 = i * period, t1 = (i + 1) * period;
+            if(duration > 0.0 && t0 >= duration) break;
+
+            ev::packet<AE> &packet = output_port.prepare();
+            {
+                ev::metricTimer timer(generate_ns);
+                generator.generate(packet, t0, t1, i);
+            }
+            packet.duration(period);
+
+            //the data is "captured" at the end of the packet
+            double now = yarp::os::Time::now();
+            if(realtime) {
+                double wait = start + t1 - now;
+                if(wait > 0.0) {
+                    yarp::os::Time::delay(wait);
+                    now = start + t1;
+                } else if(-wait > period) {
+                    counter_late++;
+                }
+                lag_us.set(wait < 0.0 ? (int64_t)(-wait * 1e6) : 0);
+            }
+            packet.envelope() = Stamp((int)i, now);
+
+            counter_packets++;
+            counter_events += packet.size();
+            events.add(packet.size());
+            bytes.add(packet.size() * sizeof(AE));
+            packets.add();
+            queued.set(output_port.queued());
+
+            ev::metricTimer timer(send_ns);
+            output_port.write();
+        }
+        yInfo() << "Finished generating";
+    }
+};
+
+int main(int argc, char * argv[])
+{
+    /* prepare and configure the resource finder */
+    yarp::os::ResourceFinder rf;
+    rf.configure( argc, argv );
+
+    /* create the module */
+    vSynth instance;
+    return instance.runModule(rf);
+}
@@ -51,10 +51,16 @@ private:
     int d2y_eventcount{0};
     int d2y_packetcount{0};
     int d2y_filtered{0};
+    ev::metrics metrics;
+    bool metrics_open{false};
 
     //this thread runs constantly to write YARP data to the device (e.g. spinnaker)
     void y2d_run() 
     {        
+        ev::threadMetrics &m = metrics.thread("y2d");
+        ev::metricCounter &events = m.counter("events");
+        ev::metricCounter &packets = m.counter("packets");
+        ev::metricHistogram &write_ns = m.histogram("write_ns");
         while(params.hpu_write)
         {
             if(y2d_port.isClosed()) {
@@ -65,8 +71,11 @@ private:
             const ev::packet<ev::AE>* packet = y2d_port.read(true); //blocking read
             if(!packet) return; //when interrupt is called returns null
 
+            ev::metricTimer timer(write_ns);
             int written = packet->pushToDevice(fd);
             y2d_eventcount += written / sizeof(ev::AE);
+            events.add(written / sizeof(ev::AE));
+            packets.add();
         }
     }
 
@@ -77,15 +86,26 @@ private:
         int max_bytes_per_read = max_events_per_read * sizeof(ev::AE);
         std::vector<ev::AE> buffer(max_events_per_read);
 
+        ev::threadMetrics &m = metrics.thread("d2y");
+        ev::metricCounter &events = m.counter("events");
+        ev::metricCounter &bytes = m.counter("bytes");
+        ev::metricCounter &reads = m.counter("reads");
+        ev::metricCounter &packets = m.counter("packets");
+        ev::metricCounter &filtered = m.counter("filtered");
+        ev::metricHistogram &sort_ns = m.histogram("sort_ns");
+        ev::metricHistogram &send_ns = m.histogram("send_ns");
+        ev::metricGauge &queued = m.gauge("send_queue");
+
         ev::packet<ev::AE>* packet_left = &d2y_port.prepare();
-        packet_left->size(max_events_per_read);
+        packet_left->reserve(max_events_per_read);
         double tic_left = yarp::os::Time::now();
     
         ev::packet<ev::AE>* packet_right = &d2y_port_2.prepare();
-        packet_right->size(max_events_per_read);
+        packet_right->reserve(max_events_per_read);
         double tic_right = yarp::os::Time::now();
 
         ev::packet<ev::AE>* packet_skin = &d2y_port_skin.prepare();
+        packet_skin->reserve(max_events_per_read);
         double tic_skin = yarp::os::Time::now();
 
         ev::refractoryFilter refrac;
@@ -110,8 +130,13 @@ private:
             int events_read = r / sizeof(ev::AE);
             d2y_eventcount += events_read;
             d2y_packetcount++;
+            events.add(events_read);
+            bytes.add(r);
+            reads.add();
+            int filtered_before = d2y_filtered;
 
             double toc = yarp::os::Time::now();
+            auto sort_start = std::chrono::steady_clock::now();
 
             //sort the events
             if(params.filter) 
@@ -157,9 +182,16 @@ private:
                 }
             }
 
+            filtered.add(d2y_filtered - filtered_before);
+            sort_ns.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - sort_start).count());
+            queued.set(d2y_port.queued() + d2y_port_2.queued() + d2y_port_skin.queued());
+
             if(d2y_port.isWriting() || d2y_port_2.isWriting() || d2y_port_skin.isWriting())
                 continue;
 
+            ev::metricTimer timer(send_ns);
+
             if(packet_left->size()) 
             {
                 packet_left->duration(toc - tic_left);
@@ -168,7 +200,9 @@ private:
                 packet_left->envelope() = {sequence_left++, toc};
                 //if(packet_left->size() / packet_left->duration() < params.rate_limit) {
                     d2y_port.write();
+                    packets.add();
                     packet_left = &d2y_port.prepare();
+                    packet_left->reserve(max_events_per_read);
                 //} else {
                 //    packet_left->clear();
                 //    yWarning() << "Dropped packet left";
@@ -183,7 +217,9 @@ private:
                 packet_right->envelope() = {sequence_right++, toc};
                 //if(packet_right->size() / packet_right->duration() < params.rate_limit) {
                     d2y_port_2.write();
+                    packets.add();
                     packet_right = &d2y_port_2.prepare();
+                    packet_right->reserve(max_events_per_read);
                 //} else {
                 //    packet_right->clear();
                 //    yWarning() << "Dropped packet right";
@@ -197,7 +233,9 @@ private:
                 static int sequence_skin = 0;
                 packet_skin->envelope() = {sequence_skin++, toc};
                 d2y_port_skin.write();
+                packets.add();
                 packet_skin = &d2y_port_skin.prepare();
+                packet_skin->reserve(max_events_per_read);
             }   
         }
 
@@ -209,6 +247,13 @@ private:
     //this thread runs constantly to read device (e.g. camera) data and send to YARP 
     void d2y_run() 
     {
+        ev::threadMetrics &m = metrics.thread("d2y");
+        ev::metricCounter &events = m.counter("events");
+        ev::metricCounter &bytes = m.counter("bytes");
+        ev::metricCounter &packets = m.counter("packets");
+        ev::metricHistogram &send_ns = m.histogram("send_ns");
+        ev::metricGauge &queued = m.gauge("send_queue");
+
         while(params.hpu_read) {
 
             //allocate the space in the packet within the output port
@@ -241,14 +286,40 @@ private:
             //update stats for keeping tracking of event counts
             d2y_eventcount += packet.size();
             d2y_packetcount++;
+            events.add(packet.size());
+            bytes.add(packet.size() * sizeof(ev::AE));
+            packets.add();
+            queued.set(d2y_port.queued());
 
             //send the packet of data (the port does in a second thread)
             static int sequence = 0;
             packet.envelope() = {sequence++, toc};
+            ev::metricTimer timer(send_ns);
             d2y_port.write();
         }
     }
 
+    bool openShared()
+    {
+        //a slot holds the events of one device read, which are read in place
+        size_t slot_events = params.max_packet_size / sizeof(ev::AE) + (params.max_packet_size % sizeof(ev::AE) ? 1 : 0);
+        std::vector<std::pair<ev::BufferedPort<ev::AE> *, std::string> > outputs;
+        if(params.split) {
+            outputs.push_back({&d2y_port, params.module + "/left/AE:o"});
+            outputs.push_back({&d2y_port_2, params.module + "/right/AE:o"});
+            outputs.push_back({&d2y_port_skin, params.module + "/skin/AE:o"});
+        } else {
+            outputs.push_back({&d2y_port, params.module + "/AE:o"});
+        }
+        for(auto &o : outputs) {
+            if(!o.first->openSharedWriter(o.second, params.shared_slots, slot_events)) {
+                yError() << "Could not open shared memory" << o.second;
+                return false;
+            }
+        }
+        return true;
+    }
+
     void start()
     {
         if(params.hpu_write)
@@ -273,10 +344,17 @@ public:
         bool spin_loopback{false};
         unsigned int max_packet_size{8*7500};
         bool split{false};
+        bool compress{false};
+        unsigned int async{0};
+        bool trace{false};
+        bool metrics{true};
+        string prometheus{""};
         double filter{0.0};
         int roi_max_x{640};
         int roi_max_y{480};
         double rate_limit{40e6};
+        bool shared{false};
+        unsigned int shared_slots{128};
 
     } params;
 
@@ -292,6 +370,11 @@ public:
         if(params.spinnaker && params.spin_loopback) yWarning() << "Spinnaker in loopback mode";
         yInfo() << "Maximum " << params.max_packet_size / 8 << "AE in a packet";
         if(params.split) yInfo() << "Splitting stereo and skin (d2y)";
+        if(params.compress) yInfo() << "Compressing output packets (d2y)";
+        if(params.async) yInfo() << "Sending up to" << params.async << "queued packets from a separate thread (d2y)";
+        if(params.trace) yInfo() << "Tracing latency from capture (d2y)";
+        if(params.shared) yInfo() << "Sending through" << params.shared_slots << "shared memory slots (d2y)";
+        if(params.metrics) yInfo() << "Publishing metrics on" << params.module + "/metrics:o";
         if(params.filter > 0.0) yInfo() << "Artificial refractory period:" << params.filter << "seconds";
 
         // open the device
@@ -326,6 +409,22 @@ public:
         //output device information
         yInfo() << HPUDeviceInfo(fd);
 
+        //packets are sent by the port's own thread, so the device is read
+        //while the connection is busy
+        d2y_port.setAsyncWrite(params.async);
+        d2y_port_2.setAsyncWrite(params.async);
+        d2y_port_skin.setAsyncWrite(params.async);
+        if(params.trace) {
+            d2y_port.setTrace(params.module);
+            d2y_port_2.setTrace(params.module);
+            d2y_port_skin.setTrace(params.module);
+        }
+
+        //the shared memory rings are opened before the reading thread uses
+        //the ports, and do not need the YARP network
+        if(params.hpu_read && params.shared && !openShared())
+            return false;
+
         //start reading/writing threads.
         start();
         return true;
@@ -339,6 +438,13 @@ public:
             return true;
         }
 
+        if(params.metrics && !metrics_open)
+            metrics_open = metrics.open(params.module, params.prometheus);
+
+        d2y_port.setCompression(params.compress);
+        d2y_port_2.setCompression(params.compress);
+        d2y_port_skin.setCompression(params.compress);
+
         if(params.hpu_read && d2y_port.isClosed()) {
             std::string port_name = params.module + "/AE:o";
             if(params.split) port_name = params.module + "/left/AE:o";
@@ -377,10 +483,17 @@ public:
 
     void stop()
     {
-        if(params.hpu_read) 
-            { params.hpu_read = false; d2y_port.close(); d2y_port_2.close(); d2y_port_skin.close(); d2y_thread.join(); }
+        //the reading thread can still be filling a shared memory slot, so it
+        //is stopped before the ports are closed
+        if(params.hpu_read) {
+            params.hpu_read = false;
+            d2y_port.interrupt(); d2y_port_2.interrupt(); d2y_port_skin.interrupt();
+            d2y_thread.join();
+            d2y_port.close(); d2y_port_2.close(); d2y_port_skin.close();
+        }
         if(params.hpu_write)
             { params.hpu_write = false; y2d_port.close(); y2d_thread.join(); }
+        metrics.close();
     }
 
     std::string status_message()
@@ -413,6 +526,13 @@ public:
                     << dt << " seconds ("
                     << (int)(100.0 * d2y_filtered / (double)d2y_eventcount) << "% filtered)" << std::endl;
 
+            if(params.async) {
+                ev::writeInfo w = d2y_port.writeStats();
+                ss << "[SEND ] " << w.packets << " packets waited " 
+                   << (int)(w.mean_wait * 1e6) << "us on average, "
+                   << (int)(w.max_wait * 1e6) << "us at most" << std::endl;
+            }
+
             d2y_eventcount = 0;
             d2y_packetcount = 0;
             d2y_filtered = 0;
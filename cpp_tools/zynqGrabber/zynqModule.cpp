@@ -60,6 +60,13 @@ class zynqGrabberModule : public yarp::os::RFModule {
             yInfo() << "--hpu_write <bool>[false]: write to hpu device";
             yInfo() << "--packet_size <int>[5120]: standard events in packet (not enforced)";
             yInfo() << "--split <bool>[false]: split data in channels";
+            yInfo() << "--compress <bool>[false]: send compressed packets to save network bandwidth";
+            yInfo() << "--async <int>[0]: packets queued for a sending thread, 0 = send from the reading thread";
+            yInfo() << "--shared <bool>[false]: send packets through shared memory rings named after the output ports, for readers on this host";
+            yInfo() << "--shared_slots <int>[128]: packets held by each shared memory ring";
+            yInfo() << "--trace <bool>[false]: stamp packets for end-to-end latency tracing";
+            yInfo() << "--metrics <bool>[true]: publish throughput, timing and cpu metrics on <name>/metrics:o";
+            yInfo() << "--prometheus <string>[\"\"]: also write the metrics to this Prometheus text file";
             yInfo() << "--filter <double>[0.0]: temporal filter of vision (ms) 0.0 = off";
             return false;
         }
@@ -108,6 +115,16 @@ class zynqGrabberModule : public yarp::os::RFModule {
             hpu.params.max_packet_size = 8 * rf.check("packet_size", yarp::os::Value("5120")).asInt32();
             hpu.params.split = rf.check("split") &&
                                 rf.check("split", Value(true)).asBool();
+            hpu.params.compress = rf.check("compress") &&
+                                  rf.check("compress", Value(true)).asBool();
+            hpu.params.async = rf.check("async", Value(0)).asInt32();
+            hpu.params.shared = rf.check("shared") &&
+                                rf.check("shared", Value(true)).asBool();
+            hpu.params.shared_slots = rf.check("shared_slots", Value(128)).asInt32();
+            hpu.params.trace = rf.check("trace") &&
+                               rf.check("trace", Value(true)).asBool();
+            hpu.params.metrics = rf.check("metrics", Value(true)).asBool();
+            hpu.params.prometheus = rf.check("prometheus", Value("")).asString();
             hpu.params.filter = rf.check("filter", Value(0.0)).asFloat64();
 
             if(!hpu.configure())
@@ -18,10 +18,11 @@
 #pragma once
 #include <event-driven/core.h>
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
 #include <deque>
-#include <thread>
 #include <mutex>
-#include <condition_variable>
+#include <thread>
 
 #include "surface.h"
 
@@ -32,61 +33,110 @@ class corner_detector
 {
 private:
 
-    cv::Mat LUT;
+    cv::Mat surface;
+    cv::Mat blurred;
     ev::SCARF scarf;
     int harris_block_size{7};
 
+    //the Harris responses, computed from snapshots of the SCARF surface and
+    //read by detect()
+    tripleBuffer<cv::Mat> LUTs;
     std::thread harris_thread;
-    std::mutex m;
-    std::condition_variable signal;
-    
+    std::atomic<bool> running{false};
+
+    //the Harris thread sleeps until detect() publishes a surface, the lock
+    //is only needed if it sleeps
+    std::mutex harris_m;
+    std::condition_variable harris_wake;
+    std::atomic<bool> harris_waiting{false};
+
     double threshold{0.0};
     double score_mean{0.0};
     double score_variance{0.0};
     int count{0};
 
+    //publish the Harris response of image
+    void computeLUT(const cv::Mat &image)
+    {
+        image.convertTo(blurred, CV_8U, 255);
+        cv::GaussianBlur(blurred, blurred, cv::Size(5, 5), 0, 0);
+        cv::cornerHarris(blurred, LUTs.back(), harris_block_size, 3, 0.04);
+        LUTs.publish();
+    }
+
     void updateLUT()
     {
-        static cv::Mat blurred;
-        while(harris_block_size > 0) 
+        while(true)
         {
-            // std::unique_lock<std::mutex> lk(m);
-            // signal.wait(lk, [this]{return eros_updated;});
-            // eros_updated = false;
-            // lk.unlock();
-            scarf.getSurface().convertTo(blurred, CV_8U, 255);
-            cv::GaussianBlur(blurred, blurred, cv::Size(5, 5), 0, 0);
-            cv::cornerHarris(blurred, LUT, harris_block_size, 3, 0.04);
+            //wait for detect() to publish a new surface
+            {
+                std::unique_lock<std::mutex> lk(harris_m);
+                harris_waiting = true;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                harris_wake.wait(lk, [this]{return !running || scarf.snapshot(surface);});
+                harris_waiting = false;
+            }
+            if(!running) return;
+            computeLUT(surface);
         }
     }
 
+    void wakeHarris()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(!harris_waiting) return;
+        std::lock_guard<std::mutex> lk(harris_m);
+        harris_wake.notify_one();
+    }
+
 
 public:
 
     void stop()
     {
-        harris_block_size = -1;
-        harris_thread.join();
+        {
+            std::lock_guard<std::mutex> lk(harris_m);
+            running = false;
+        }
+        harris_wake.notify_one();
+        if(harris_thread.joinable())
+            harris_thread.join();
     }
 
-    void initialise(int height, int width, int harris_block_size)
+    /// \brief threaded: the Harris response is recomputed continuously in a
+    /// separate thread. Otherwise it is only recomputed by refresh(), so the
+    /// detections do not depend on thread timing (e.g. for offline replay).
+    void initialise(int height, int width, int harris_block_size, bool threaded = true)
     {
         if (harris_block_size % 2 == 0)
             harris_block_size += 1;
         this->harris_block_size = harris_block_size;
         scarf.initialise({width, height}, 10);
-        LUT = cv::Mat(height, width, CV_32F);
-        harris_thread = std::thread([this]{updateLUT();});
+        LUTs.back() = cv::Mat::zeros(height, width, CV_32F);
+        LUTs.publish();
+        if(threaded) {
+            running = true;
+            harris_thread = std::thread([this]{updateLUT();});
+        }
+    }
+
+    /// \brief recompute the Harris response when not threaded
+    void refresh()
+    {
+        computeLUT(scarf.getSurface());
     }
 
     template <typename T>
     void detect(T begin, T end, std::deque<AE> &results)
     {
-        //first update the EROS
+        //the latest Harris response isn't written again until the next call
+        const cv::Mat &LUT = LUTs.latest();
+
+        //first update the SCARF
         for(auto &v = begin; v != end; v++) {
             scarf.update(v->x, v->y, v->p);
 
-            float& score = LUT.at<float>(v->y, v->x);
+            float score = LUT.at<float>(v->y, v->x);
             if(score > threshold)
                  results.push_back(*v);
 
@@ -101,12 +151,9 @@ public:
         threshold = score_mean + 2*sqrt(score_variance / count);
         //threshold = 0.00001;
 
-        // std::unique_lock<std::mutex> lk(m);
-        // eros_updated = true;
-        // lk.unlock();
-        // signal.notify_one();
-
-
+        //hand the surface to the Harris thread, if it is waiting for one
+        scarf.publish();
+        wakeHarris();
     }
 
 };
@@ -65,12 +65,12 @@ void zrtBlock::updateConnections(cv::Mat &sae, int d, double triplet_tolerance)
 }
 
 //udate the flow state from the connection buffer
-void zrtBlock::updateFlow(size_t n)
+void zrtBlock::updateFlow(double time, size_t n)
 {
     if(n < 3) n = 3;
     if(x_dist.size() < n) {
         double magnitude = sqrt(flow.x*flow.x+flow.y*flow.y);
-        double max_mag = 1.0 / (yarp::os::Time::now() - last_update_tic);
+        double max_mag = 1.0 / (time - last_update_tic);
         if(magnitude > max_mag) flow *= max_mag / magnitude;
         return;
     } else {
@@ -78,14 +78,14 @@ void zrtBlock::updateFlow(size_t n)
         std::sort(y_dist.begin(), y_dist.end());
         flow = {x_dist[x_dist.size()/2], y_dist[y_dist.size()/2]};
         x_dist.clear(); y_dist.clear();
-        last_update_tic = yarp::os::Time::now();
+        last_update_tic = time;
     }      
 }
 
 void zrtFlow::initialise(cv::Size res, int block_size, int max_N, int connection_length, int con_buf_min, double trip_tol, int smooth_factor)
 {
-    //initialise the SAE
-    sae = cv::Mat(res, CV_64F);
+    //initialise the SAE (zeroed, so connections never use stale memory)
+    sae = cv::Mat::zeros(res, CV_64F);
 
     this->con_len = connection_length;
     this->trip_tol = trip_tol;
@@ -133,12 +133,19 @@ void zrtFlow::initialise(cv::Size res, int block_size, int max_N, int connection
 void zrtFlow::add(int u, int v, double t)
 {
     sae.at<double>(v, u) = t;
-    blockmap[v*sae.cols+u]->add({u, v});
+    //pixels in the border not covered by whole blocks have no block
+    zrtBlock *block = blockmap[v*sae.cols+u];
+    if(block) block->add({u, v});
 }
 
 //go through each block and update the list of flow vectors
 //update the final flow per pixel
 void zrtFlow::update()
+{
+    update(yarp::os::Time::now());
+}
+
+void zrtFlow::update(double time)
 {
     //for each block
     for(int by = 0; by < array_dims.height; by++) {
@@ -153,7 +160,7 @@ void zrtFlow::update()
             b.updateConnections(sae, con_len, trip_tol);
 
             //calculate the flow given the connections in
-            b.updateFlow(con_buf_min);
+            b.updateFlow(time, con_buf_min);
 
                 //asign flow to the array
             block_flow[X].at<float>(by, bx) = b.flow.x;
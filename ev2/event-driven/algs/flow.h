@@ -57,8 +57,9 @@ public:
     //update connections for each new event
     void updateConnections(cv::Mat &sae, int d, double triplet_tolerance);
 
-    //udate the flow state from the connection buffer
-    void updateFlow(size_t n = 0);
+    //udate the flow state from the connection buffer. time is the clock
+    //(in seconds) used to decay flow that is no longer updated
+    void updateFlow(double time, size_t n = 0);
 
 };
 
@@ -98,6 +99,11 @@ public:
     //update the final flow per pixel
     void update();
 
+    //as update() but using time (in seconds) as the clock instead of the
+    //wall-clock, e.g. the event time, so offline processing is repeatable
+    //and not limited to real-time
+    void update(double time);
+
     cv::Mat makebgr();
 };
 
@@ -15,16 +15,90 @@ void surface::init(int width, int height, int kernel_size, double parameter)
     this->half_kernel = kernel_size / 2;
     this->parameter = parameter;
 
-    surf = cv::Mat(height+half_kernel*2, width+half_kernel*2, CV_64F, cv::Scalar(0.0));
+    surf = cv::Mat(height+half_kernel*2, width+half_kernel*2, depth, cv::Scalar(0.0));
     actual_region = {half_kernel, half_kernel, width, height};
 }
 
-void surface::temporalDecay(double ts, double alpha) {
-    surf *= cv::exp(alpha * (time_now - ts));
+threadPool *surface::batchPool(size_t n)
+{
+    //smaller batches aren't worth waking the pool for
+    static const size_t minimum_batch = 4096;
+    if(!parallel || n < minimum_batch || halo() < 0 || surf.empty())
+        return nullptr;
+    threadPool *p = pool ? pool : &threadPool::shared();
+    if(p->size() < 2)
+        return nullptr;
+
+    //two bands per thread, each taller than a kernel so an event is in at
+    //most two bands
+    size_t n_bands = 2 * p->size();
+    band_rows = std::max((int)((surf.rows + n_bands - 1) / n_bands), 2 * halo() + 1);
+    bands.resize((surf.rows + band_rows - 1) / band_rows);
+    for(auto &b : bands) b.clear();
+    return p;
+}
+
+void surface::updateBands(threadPool *p)
+{
+    p->run(bands.size(), [this](size_t b) {
+        const int row_begin = (int)b * band_rows;
+        const int row_end = std::min(row_begin + band_rows, surf.rows);
+        for(auto &v : bands[b])
+            updateRows(v.x, v.y, v.t, v.p, row_begin, row_end);
+    });
+}
+
+void surface::publish(bool force)
+{
+    if(!force && !snapshot_wanted.exchange(false, std::memory_order_relaxed))
+        return;
+    getSurface().copyTo(snapshots.back());
+    snapshots.publish();
+}
+
+bool surface::snapshot(cv::Mat &image)
+{
+    snapshot_wanted.store(true, std::memory_order_relaxed);
+    if(!snapshots.fresh())
+        return false;
+    snapshots.latest().copyTo(image);
+    return true;
+}
+
+void surface::update(const soa_batch &batch, double t)
+{
+    threadPool *p = batchPool(batch.size());
+    if(!p) {
+        updateSequence(batch, t);
+        return;
+    }
+    for(size_t i = 0; i < batch.size(); i++)
+        addToBands(batch.x[i], batch.y[i], batch.p[i], batch.time(i, t));
+    updateBands(p);
+}
+
+bool surface::temporalDecay(double ts, double alpha) {
+    //SAE stores times, which cannot decay
+    if(depth == CV_32S)
+        return false;
+    //integer surfaces are scaled in floating point and rounded
+    surf.convertTo(surf, depth, std::exp(alpha * (time_now - ts)));
     time_now = ts;
+    return true;
 }
 
-void surface::spatialDecay(int k) 
+bool surface::spatialDecay(int k) 
 {
-    cv::GaussianBlur(surf, surf, cv::Size(k, k), 0);
+    if(depth == CV_32S)
+        return false;
+    if(depth == CV_32F || depth == CV_64F) {
+        cv::GaussianBlur(surf, surf, cv::Size(k, k), 0);
+    } else {
+        //blur integer surfaces in floating point so they are only rounded once
+        cv::Mat blurred;
+        surf.convertTo(blurred, CV_32F);
+        cv::GaussianBlur(blurred, blurred, cv::Size(k, k), 0);
+        blurred.convertTo(surf, depth);
+    }
+    return true;
 }
\ No newline at end of file
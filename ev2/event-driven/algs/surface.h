@@ -1,10 +1,25 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <iterator>
+#include <limits>
 #include <tuple>
+#include <type_traits>
+#include <utility>
+#include "event-driven/core/batch.h"
+#include "event-driven/core/pool.h"
+#include "event-driven/core/snapshot.h"
 
 namespace ev {
 
+/// \brief the packet time of an iterator of ev::window or ev::offlineLoader,
+/// or 0 for other iterators
+template <typename It>
+inline auto iteratorTime(It &it, int) -> decltype((double)it.timestamp()) { return it.timestamp(); }
+template <typename It>
+inline double iteratorTime(It &, long) { return 0.0; }
+
 class surface 
 {
 protected:
@@ -15,160 +30,618 @@ protected:
 
     cv::Rect actual_region;
     cv::Mat surf;
+    int depth{CV_64F};
+
+    //batches are split into bands of rows of surf. Each band gets, in
+    //order, every event whose update touches its rows.
+    struct bandEvent { uint16_t x, y; int32_t p; double t; };
+    std::vector<std::vector<bandEvent>> bands;
+    int band_rows{0};
+    bool parallel{true};
+    threadPool *pool{nullptr};
+
+    /// \brief rows either side of the event's row written by an update, or
+    /// -1 (the default) if the surface isn't updated in bands: its updates
+    /// read pixels another band may write, or are too cheap to be worth it
+    virtual int halo() { return -1; }
+
+    /// \brief update with an event, only writing rows [row_begin, row_end)
+    /// of surf
+    virtual void updateRows(int x, int y, double t, int p, int row_begin, int row_end)
+    {
+        int row = y + half_kernel;
+        if(row >= row_begin && row < row_end) update(x, y, t, p);
+    }
+
+    /// \brief update with a batch on the calling thread. Surfaces override
+    /// it with updateEach<S>(), so the batch costs one virtual call instead
+    /// of one per event.
+    virtual void updateSequence(const soa_batch &batch, double t)
+    {
+        for(size_t i = 0; i < batch.size(); i++)
+            update(batch.x[i], batch.y[i], batch.time(i, t), batch.p[i]);
+    }
+
+    //calls S::update directly, so it can be inlined into the loop
+    template <typename S>
+    void updateEach(const soa_batch &batch, double t)
+    {
+        S &s = static_cast<S &>(*this);
+        for(size_t i = 0; i < batch.size(); i++)
+            s.S::update(batch.x[i], batch.y[i], batch.time(i, t), batch.p[i]);
+    }
+
+    /// \brief the pool for a batch of n events, or nullptr to update them
+    /// one by one on the calling thread
+    threadPool *batchPool(size_t n);
+    inline void addToBands(int x, int y, int p, double t)
+    {
+        const int h = halo();
+        const int first = (y + half_kernel - h) / band_rows;
+        const int last = (y + half_kernel + h) / band_rows;
+        for(int b = first; b <= last; b++)
+            bands[b].push_back({(uint16_t)x, (uint16_t)y, (int32_t)p, t});
+    }
+    void updateBands(threadPool *pool);
+
+    //images published for readers on other threads
+    tripleBuffer<cv::Mat> snapshots;
+    std::atomic<bool> snapshot_wanted{false};
 
 public:
    
     virtual cv::Mat getSurface();
     virtual void init(int width, int height, int kernel_size = 5, double parameter = 0.0);
     virtual inline void update(int x, int y, double ts, int p) = 0;
-    void temporalDecay(double ts, double alpha);
-    void spatialDecay(int k);
-};
+    /// \brief update with all events in a batch. t is the time of the final
+    /// event (see ev::soa_batch::time)
+    void update(const soa_batch &batch, double t = 0);
+
+    /// \brief update with the events [begin, end), e.g. of an ev::window or
+    /// ev::offlineLoader, timed by their packet. Large batches are updated
+    /// in bands of rows in parallel, giving the same surface as updating
+    /// the events in order.
+    template <typename It, typename = decltype((*std::declval<It&>()).x)>
+    void update(It begin, It end)
+    {
+        threadPool *p = batchPool(std::distance(begin, end));
+        if(!p) {
+            for(It it = begin; it != end; ++it)
+                update((*it).x, (*it).y, iteratorTime(it, 0), (*it).p);
+            return;
+        }
+        for(It it = begin; it != end; ++it)
+            addToBands((*it).x, (*it).y, (*it).p, iteratorTime(it, 0));
+        updateBands(p);
+    }
 
-class EROS : public surface {
-   public:
-    inline void update(int x, int y, double t = 0, int p = 0) override 
+    /// \brief the threads used by the batch updates (default
+    /// threadPool::shared()), nullptr updates on the calling thread only
+    void setPool(threadPool *pool)
     {
-        static double odecay = pow(parameter, 1.0 / kernel_size);
-        surf({x, y, kernel_size, kernel_size}) *= odecay;
-        surf.at<double>(y+half_kernel, x+half_kernel) = 255.0;
+        this->pool = pool;
+        parallel = pool != nullptr;
     }
+
+    /// \brief on the updating thread, copy getSurface() for snapshot(), if a
+    /// reader has asked for one since the last publish (or force). Never
+    /// waits for the reader.
+    void publish(bool force = false);
+
+    /// \brief from any one other thread, the most recently published
+    /// surface. Returns false, leaving image as it was, if nothing was
+    /// published since the last call. image is a copy, which the updating
+    /// thread never writes.
+    bool snapshot(cv::Mat &image);
+
+    /// \brief multiply the surface by exp(alpha * (previous ts - ts)),
+    /// rounding integer surfaces. Returns false, leaving it unchanged, for
+    /// the SAE, whose times cannot decay.
+    bool temporalDecay(double ts, double alpha);
+    /// \brief gaussian blur of size k, computed in floating point for
+    /// integer surfaces. Returns false, leaving it unchanged, for the SAE.
+    bool spatialDecay(int k);
 };
 
-class TOS : public surface 
+/// \brief the cv::Mat depth used to store a surface of type T
+template <typename T> struct surfaceDepth;
+template <> struct surfaceDepth<uint8_t> { static const int value = CV_8U; };
+template <> struct surfaceDepth<uint16_t> { static const int value = CV_16U; };
+template <> struct surfaceDepth<float> { static const int value = CV_32F; };
+template <> struct surfaceDepth<double> { static const int value = CV_64F; };
+template <> struct surfaceDepth<uint32_t> { static const int value = CV_32S; }; //read as uint32_t
+
+/// \brief K > 0 fixes the (odd) kernel size at compile time, so the
+/// neighbourhood loops are unrolled, and the kernel_size given to init() is
+/// ignored. K = 0 takes the kernel size from init(). T is the storage type.
+template <int K = 0, typename T = float>
+class basicEROS : public surface {
+    static_assert(K == 0 || K % 2, "the kernel size must be odd");
+private:
+    //integer surfaces are decayed in float
+    typename std::conditional<std::is_same<T, double>::value, double, float>::type odecay{1};
+
+public:
+    using surface::update;
+
+    basicEROS() { depth = surfaceDepth<T>::value; }
+
+    void init(int width, int height, int kernel_size = 5, double parameter = 0.0) override
+    {
+        surface::init(width, height, K ? K : kernel_size, parameter);
+        odecay = pow(parameter, 1.0 / this->kernel_size);
+    }
+
+    inline void decay(int x, int y, int j_begin, int j_end)
+    {
+        const int k = K ? K : kernel_size;
+        for(int j = j_begin; j < j_end; j++) {
+            T *row = surf.ptr<T>(y + j) + x;
+            for(int i = 0; i < k; i++)
+                row[i] = (T)(row[i] * odecay);
+        }
+    }
+
+protected:
+    int halo() override { return K ? K / 2 : half_kernel; }
+
+    void updateSequence(const soa_batch &batch, double t) override
+    {
+        updateEach<basicEROS>(batch, t);
+    }
+
+    void updateRows(int x, int y, double t, int p, int row_begin, int row_end) override
+    {
+        (void)t; (void)p;
+        const int k = K ? K : kernel_size;
+        decay(x, y, std::max(row_begin - y, 0), std::min(row_end - y, k));
+        const int c = K ? K / 2 : half_kernel;
+        if(y + c >= row_begin && y + c < row_end)
+            surf.ptr<T>(y + c)[x + c] = (T)255;
+    }
+
+public:
+    inline void update(int x, int y, double t = 0, int p = 0) override
+    {
+        (void)t; (void)p;
+        decay(x, y, 0, K ? K : kernel_size);
+        surf.ptr<T>(y + (K ? K / 2 : half_kernel))[x + (K ? K / 2 : half_kernel)] = (T)255;
+    }
+};
+using EROS = basicEROS<>;
+
+/// \brief EROS with the decay applied when the surface is read. A pixel of
+/// EROS is 255 * odecay^n, where n is the number of events in its
+/// neighbourhood since the pixel was last set. Each event increments an event
+/// counter for each tile (tile x tile pixels) within reach, and a pixel
+/// remembers the counter of its tile when set, so update() costs
+/// (2*reach+1)^2 increments, with reach = (kernel / tile) / 2.
+/// getSurface() decays every pixel and should be called at least once per
+/// 2^31 events.
+/// With tile = 1 (default) the neighbourhood is exactly the kernel and
+/// getSurface() gives the EROS image, but update() does kernel^2 increments,
+/// the same work as EROS, and reading is a pass over the whole image. Only
+/// tile > 1 gives an update cost independent of the kernel: larger tiles
+/// approximate the kernel and the decay is scaled to the area of the
+/// neighbourhood. A pixel reads 0 once it falls below 1e-3.
+class lazyEROS : public surface
 {
-   public:
-    inline void update(int x, int y, double t = 0, int p = 0) override {
+private:
+    int width{0}, height{0};
+    int tile{1}, reach{0}, hood_cols{0};
+    std::vector<int> col_tile, row_tile;
+    std::vector<uint32_t> hood;    //events near each tile, padded by reach
+    std::vector<uint32_t> stamp;   //counter of the pixel's tile when it was set
+    std::vector<float> decayed;    //255 * odecay^n, for the most recent n
+    double odecay{1.0};
+    uint32_t faded{0};             //n at which a pixel falls below 1e-3
+
+public:
+    using surface::update;
+
+    lazyEROS() { depth = surfaceDepth<float>::value; }
+
+    void init(int width, int height, int kernel_size = 5, double parameter = 0.0) override
+    {
+        init(width, height, kernel_size, parameter, 1);
+    }
+
+    /// \brief tile <= 0 chooses ~kernel_size/3, giving reach 1. Only tile = 1
+    /// gives the EROS image.
+    void init(int width, int height, int kernel_size, double parameter, int tile)
+    {
+        surface::init(width, height, kernel_size, parameter);
+        this->width = width;
+        this->height = height;
+        this->tile = tile > 0 ? std::min(tile, this->kernel_size) : std::max((this->kernel_size + 1) / 3, 1);
+        reach = (this->kernel_size / this->tile) / 2;
+
+        col_tile.resize(width);
+        for(int x = 0; x < width; x++) col_tile[x] = x / this->tile;
+        row_tile.resize(height);
+        for(int y = 0; y < height; y++) row_tile[y] = y / this->tile;
+        hood_cols = col_tile.back() + 1 + 2 * reach;
+        int hood_rows = row_tile.back() + 1 + 2 * reach;
+
+        //decay matched to the events expected in the neighbourhood
+        int side = (2 * reach + 1) * this->tile;
+        odecay = pow(parameter, (double)this->kernel_size / (side * side));
+
+        //a pixel is negligible after faded events, giving a floor of 0. Older
+        //pixels than the table are decayed with pow() in getSurface()
+        faded = 1u << 31;
+        if(odecay > 0.0 && odecay < 1.0)
+            faded = (uint32_t)std::min(ceil(log(1e-3 / 255.0) / log(odecay)), (double)faded);
+        else if(odecay <= 0.0)
+            faded = 1;
+        decayed.resize(std::min(faded, 65536u));
+        for(size_t i = 0; i < decayed.size(); i++)
+            decayed[i] = 255.0 * pow(odecay, i);
+
+        //an unset pixel has faded
+        hood.assign(hood_cols * hood_rows, faded);
+        stamp.assign(width * height, 0);
+    }
+
+    inline void update(int x, int y, double t = 0, int p = 0) override
+    {
         (void)t; (void)p;
-        // parameter default = 2
-        static const double threshold = 255.0 - kernel_size * parameter;
-        static cv::Rect roi = {0, 0, kernel_size, kernel_size};
-
-        roi.x = x; roi.y = y;
-        cv::Mat region = surf(roi);
-
-        for (auto xi = 0; xi < region.cols; xi++) {
-            for (auto yi = 0; yi < region.rows; yi++) {
-                double &p = region.at<double>(yi, xi);
-                if (p < threshold) p = 0;
-                else p--;
+        const int tx = col_tile[x], ty = row_tile[y];
+        uint32_t *h = &hood[ty * hood_cols + tx];
+        for(int j = 0; j <= 2 * reach; j++, h += hood_cols)
+            for(int i = 0; i <= 2 * reach; i++)
+                h[i]++;
+        stamp[y * width + x] = hood[(ty + reach) * hood_cols + tx + reach];
+    }
+
+    cv::Mat getSurface() override
+    {
+        const uint32_t n = decayed.size();
+        for(int y = 0; y < height; y++) {
+            float *out = surf.ptr<float>(y + half_kernel) + half_kernel;
+            uint32_t *s = &stamp[y * width];
+            const uint32_t *h = &hood[(row_tile[y] + reach) * hood_cols + reach];
+            for(int x = 0; x < width; x++) {
+                uint32_t age = h[col_tile[x]] - s[x];
+                if(age < n) {
+                    out[x] = decayed[age];
+                } else if(age < faded) {
+                    out[x] = 255.0 * pow(odecay, age);
+                } else {
+                    //keep faded pixels at the floor so the counters can
+                    //wrap without reviving them
+                    out[x] = 0.0f;
+                    s[x] = h[col_tile[x]] - faded;
+                }
             }
         }
-        surf.at<double>(y+half_kernel, x+half_kernel) = 255.0;
+        return surface::getSurface();
+    }
+
+protected:
+    void updateSequence(const soa_batch &batch, double t) override
+    {
+        updateEach<lazyEROS>(batch, t);
     }
 };
 
-class SITS : public surface {
-   public:
-    inline void update(int x, int y, double t = 0, int p = 0) override {
-        static const int maximum_value = kernel_size * kernel_size;
-        static cv::Rect roi = {0, 0, kernel_size, kernel_size};
+template <int K = 0, typename T = uint8_t>
+class basicTOS : public surface
+{
+    static_assert(K == 0 || K % 2, "the kernel size must be odd");
+private:
+    T threshold{255};
 
-        roi.x = x; roi.y = y;
-        cv::Mat region = surf(roi);
+public:
+    using surface::update;
+
+    basicTOS() { depth = surfaceDepth<T>::value; }
+
+    // parameter default = 2
+    void init(int width, int height, int kernel_size = 5, double parameter = 0.0) override
+    {
+        surface::init(width, height, K ? K : kernel_size, parameter);
+        //values at 0 are never decremented, and integer values below th
+        //are below its ceiling
+        double th = 255.0 - this->kernel_size * parameter;
+        if(std::is_floating_point<T>::value)
+            th = std::max(th, (double)std::numeric_limits<T>::min());
+        else
+            th = std::min(std::max(std::ceil(th), 1.0), (double)std::numeric_limits<T>::max());
+        threshold = (T)th;
+    }
 
-        double &c = surf.at<double>(y+half_kernel, x+half_kernel);
-        for (auto xi = 0; xi < region.cols; xi++) {
-            for (auto yi = 0; yi < region.rows; yi++) {
-                double &p = region.at<double>(yi, xi);
-                if (p >= c) p--;
+    inline void decay(int x, int y, int j_begin, int j_end)
+    {
+        const int k = K ? K : kernel_size;
+        for(int j = j_begin; j < j_end; j++) {
+            T *row = surf.ptr<T>(y + j) + x;
+            //as a product the compiler doesn't branch on each value
+            for(int i = 0; i < k; i++) {
+                const T keep = row[i] >= threshold ? (T)1 : (T)0;
+                row[i] = (T)(keep * (row[i] - (T)1));
             }
         }
-        c = maximum_value;
+    }
+
+protected:
+    int halo() override { return K ? K / 2 : half_kernel; }
+
+    void updateSequence(const soa_batch &batch, double t) override
+    {
+        updateEach<basicTOS>(batch, t);
+    }
+
+    void updateRows(int x, int y, double t, int p, int row_begin, int row_end) override
+    {
+        (void)t; (void)p;
+        const int k = K ? K : kernel_size;
+        decay(x, y, std::max(row_begin - y, 0), std::min(row_end - y, k));
+        const int c = K ? K / 2 : half_kernel;
+        if(y + c >= row_begin && y + c < row_end)
+            surf.ptr<T>(y + c)[x + c] = (T)255;
+    }
+
+public:
+    inline void update(int x, int y, double t = 0, int p = 0) override {
+        (void)t; (void)p;
+        decay(x, y, 0, K ? K : kernel_size);
+        surf.ptr<T>(y + (K ? K / 2 : half_kernel))[x + (K ? K / 2 : half_kernel)] = (T)255;
+    }
+};
+using TOS = basicTOS<>;
+
+template <int K = 0, typename T = uint8_t>
+class basicSITS : public surface {
+    static_assert(K == 0 || K % 2, "the kernel size must be odd");
+private:
+    T maximum_value{0};
+
+public:
+    using surface::update;
+
+    basicSITS() { depth = surfaceDepth<T>::value; }
+
+    void init(int width, int height, int kernel_size = 5, double parameter = 0.0) override
+    {
+        surface::init(width, height, K ? K : kernel_size, parameter);
+        //a uint8_t surface saturates for kernels larger than 15
+        maximum_value = (T)std::min(this->kernel_size * this->kernel_size, (int)std::numeric_limits<T>::max());
+    }
+
+    inline void update(int x, int y, double t = 0, int p = 0) override {
+        (void)t; (void)p;
+        const int k = K ? K : kernel_size;
+        T &centre = surf.ptr<T>(y + (K ? K / 2 : half_kernel))[x + (K ? K / 2 : half_kernel)];
+        //compared to the value before the update, including the centre, and
+        //values at 0 are never decremented
+        const T c = centre > 0 ? centre : (std::is_floating_point<T>::value ? std::numeric_limits<T>::min() : (T)1);
+        for(int j = 0; j < k; j++) {
+            T *row = surf.ptr<T>(y + j) + x;
+            for(int i = 0; i < k; i++)
+                row[i] = (T)(row[i] - (row[i] >= c ? (T)1 : (T)0));
+        }
+        centre = maximum_value;
+    }
+
+protected:
+    void updateSequence(const soa_batch &batch, double t) override
+    {
+        updateEach<basicSITS>(batch, t);
     }
 };
+using SITS = basicSITS<>;
 
-class PIM : public surface {
+template <typename T = float>
+class basicPIM : public surface {
    public:
+    using surface::update;
+
+    basicPIM() { depth = surfaceDepth<T>::value; }
+
     inline void update(int x, int y, double t = 0, int p = 0) override
     {
+        (void)t;
+        T &c = surf.ptr<T>(y+half_kernel)[x+half_kernel];
         if (p)
-            surf.at<double>(y+half_kernel, x+half_kernel) -= 1.0f;
+            c -= (T)1;
         else
-            surf.at<double>(y+half_kernel, x+half_kernel) += 1.0f;
+            c += (T)1;
     }
-};
 
+protected:
+    void updateSequence(const soa_batch &batch, double t) override
+    {
+        updateEach<basicPIM>(batch, t);
+    }
+};
+using PIM = basicPIM<>;
+
+/// \brief the time of the latest event at each pixel, stored as uint32_t
+/// microseconds after an origin. The origin follows the events forward
+/// every ~18 minutes so the ticks never wrap, and pixels not set for over
+/// ~18 minutes are clamped to the origin. getSurface() gives the time in
+/// seconds, saturated to CV_8U, and unset pixels are 0, as when it was
+/// stored as a double.
 class SAE : public surface 
 {
-   public:
+private:
+    //tick 0 is an unset pixel, so an event at origin is tick 1
+    static constexpr uint32_t rebase_ticks = 1u << 31;
+    static constexpr uint32_t kept_ticks = 1u << 30;
+    bool started{false};
+    double origin{0.0};
+
+    //move the origin forward by a whole number of ticks
+    void rebase(double shift)
+    {
+        const uint32_t s = shift < UINT32_MAX ? (uint32_t)shift : UINT32_MAX;
+        for(int y = 0; y < surf.rows; y++) {
+            uint32_t *row = surf.ptr<uint32_t>(y);
+            for(int x = 0; x < surf.cols; x++)
+                if(row[x]) row[x] = row[x] > s ? row[x] - s : 1;
+        }
+        origin += shift * 1e-6;
+    }
+
+public:
+    using surface::update;
+
+    SAE() { depth = surfaceDepth<uint32_t>::value; }
+
+    void init(int width, int height, int kernel_size = 5, double parameter = 0.0) override
+    {
+        surface::init(width, height, kernel_size, parameter);
+        started = false;
+        origin = 0.0;
+    }
+
     inline void update(int x, int y, double t = 0, int p = 0) override
     {
-        surf.at<double>(y+half_kernel, x+half_kernel) = t;
+        (void)p;
+        if(!started) { origin = t; started = true; }
+        double ticks = (t - origin) * 1e6 + 1.5;
+        if(ticks >= rebase_ticks) {
+            rebase(floor(ticks - kept_ticks));
+            ticks = (t - origin) * 1e6 + 1.5;
+        }
+        surf.ptr<uint32_t>(y+half_kernel)[x+half_kernel] = ticks > 1.0 ? (uint32_t)ticks : 1;
+    }
+
+    /// \brief the time of the latest event at (x, y) in seconds, 0 if unset
+    inline double time(int x, int y)
+    {
+        uint32_t ticks = surf.ptr<uint32_t>(y+half_kernel)[x+half_kernel];
+        return ticks ? origin + (ticks - 1) * 1e-6 : 0.0;
+    }
+
+    cv::Mat getSurface() override
+    {
+        cv::Mat output(actual_region.height, actual_region.width, CV_8U);
+        for(int y = 0; y < actual_region.height; y++) {
+            const uint32_t *in = surf.ptr<uint32_t>(y+half_kernel) + half_kernel;
+            uchar *out = output.ptr<uchar>(y);
+            for(int x = 0; x < actual_region.width; x++) {
+                double t = in[x] ? origin + (in[x] - 1) * 1e-6 : 0.0;
+                out[x] = t <= 0.0 ? 0 : t >= 255.0 ? 255 : (uchar)std::lround(t);
+            }
+        }
+        return output;
+    }
+
+protected:
+    void updateSequence(const soa_batch &batch, double t) override
+    {
+        updateEach<SAE>(batch, t);
     }
 };
 
-class BIN : public surface
+template <typename T = uint8_t>
+class basicBIN : public surface
 {
    public:
+    using surface::update;
+
+    basicBIN() { depth = surfaceDepth<T>::value; }
+
     inline void update(int x, int y, double t = 0, int p = 0) override
     {
-        surf.at<double>(y+half_kernel, x+half_kernel) = 255.0;
+        (void)t; (void)p;
+        surf.ptr<T>(y+half_kernel)[x+half_kernel] = (T)255;
+    }
+
+protected:
+    void updateSequence(const soa_batch &batch, double t) override
+    {
+        updateEach<basicBIN>(batch, t);
     }
 };
+using BIN = basicBIN<>;
 
 // Set of Centre Active Receptive Fields
 class CARF
 {
 friend class SCARF;
-private:
-    //parameters
+public:
     struct pnt {
         int u:13;
         int v:13;
         int p:3;
         int c:3;
     };
-    int N{0};
 
-    //variables
+private:
+    //the N events of the ring, stored in SCARF::points
+    pnt *points{nullptr};
+    int N{0};
     int i{0};
-    std::vector<pnt> points;
-    cv::Mat img;
-    float C;
-
-public:
-
-    CARF(int N, cv::Mat img, float C = 0.3) {
-        points.resize(N, {0, 0, 0, 0});
-        this->N = N;
-        this->img = img; //shallow reference
-        this->C = C;
-    }
 
-    inline void add(const CARF::pnt &p)
+    //img is the SCARF surface with cols columns
+    inline void add(const CARF::pnt &p, float *img, int cols, float C)
     {
         if(++i >= N) i = 0;
-        if(points[i].c) img.at<float>(points[i].v, points[i].u) -= C;
-        if(p.c) img.at<float>(p.v, p.u) += C;
+        if(points[i].c) img[points[i].v * cols + points[i].u] -= C;
+        if(p.c) img[p.v * cols + p.u] += C;
         points[i] = p;
     }
 };
 
 class SCARF
 {
+public:
+
+    /// \brief the events held by a receptive field, in ring order, without
+    /// copying them. Only valid until the next initialise().
+    struct ring {
+        const CARF::pnt *first{nullptr};
+        const CARF::pnt *last{nullptr};
+        const CARF::pnt *begin() const { return first; }
+        const CARF::pnt *end() const { return last; }
+        size_t size() const { return last - first; }
+        const CARF::pnt &operator[](size_t i) const { return first[i]; }
+    };
+
 private:
+    //receptive fields a pixel is connected to. rf[0] is the field it is
+    //the centre of, bit k of valid is set if rf[k] exists
+    struct links {
+        uint16_t rf[4];
+        uint8_t valid;
+    };
+
     //parameters
     cv::Size count{{0, 0}};
     cv::Size dims{{0, 0}};
+    float C{0.3f};
 
     //variables
     cv::Mat img;
+    std::vector<CARF::pnt> points;
     std::vector<CARF> rfs;
-    std::vector<std::array<CARF*, 4>> cons_map;
+    std::vector<links> cons_map;
+
+    //images published for readers on other threads
+    tripleBuffer<cv::Mat> snapshots;
+    std::atomic<bool> snapshot_wanted{false};
 
 public:
 
-    void initialise(cv::Size img_res, int rf_size, double alpha = 1.0, double C = 0.3)
+    bool initialise(cv::Size img_res, int rf_size, double alpha = 1.0, double C = 0.3)
     {
         if(rf_size % 2) rf_size++;
-        initialise(img_res, {(img_res.width/rf_size)-1, (img_res.height/rf_size)-1}, alpha, C);
+        return initialise(img_res, {(img_res.width/rf_size)-1, (img_res.height/rf_size)-1}, alpha, C);
     }
 
-    void initialise(cv::Size img_res, cv::Size rf_res, double alpha = 1.0, double C = 0.3)
+    /// \brief returns false if there are more receptive fields than can be
+    /// indexed (65535)
+    bool initialise(cv::Size img_res, cv::Size rf_res, double alpha = 1.0, double C = 0.3)
     {
+        if(rf_res.area() > std::numeric_limits<uint16_t>::max())
+            return false;
+
         img = cv::Mat::zeros(img_res, CV_32F);
         count = rf_res;
+        this->C = C;
 
         //size of a receptive field removeing some pixels from the border, make sure the receptive field
         //is an even number
@@ -177,28 +650,33 @@ public:
         if(dims.width%2) {dims.width--;}
 
         //N is the maximum amount of pixels in the FIFO
-        int N = dims.area() * alpha * 0.5;
+        int N = std::max((int)(dims.area() * alpha * 0.5), 1);
+
+        //make the CARF receptive fields, with their rings one after another
+        points.assign((size_t)rf_res.area() * N, {0, 0, 0, 0});
+        rfs.assign(rf_res.area(), CARF());
+        for(size_t k = 0; k < rfs.size(); k++) {
+            rfs[k].points = points.data() + k * N;
+            rfs[k].N = N;
+        }
+
+        //make the connection map. One entry per pixel
+        cons_map.assign(img_res.area(), links{{0, 0, 0, 0}, 0});
 
-        //make the connection map. One entry per pixel . each entry = [id id id id];
-        cons_map.resize(img_res.area());
-        //make the CARF receptive fields
-        rfs.resize(rf_res.area(), CARF(N, img, C));
-        
         //for each pixel
         for(int y = 0; y < img_res.height; y++) {
             for(int x = 0; x < img_res.width; x++) {
 
                 auto &connection = cons_map[y*img_res.width + x];
-                int i = 0;
                 int xm = x - dims.width/2; int ym = y - dims.height/2;
 
                 //as x/y can be negative we allow rfx and rfy to be negative indices.
                 int rfx = std::floor((double)xm/ dims.width);
                 int rfy = std::floor((double)ym/ dims.height);
-                if(rfx < 0 || rfy < 0 || rfx >= rf_res.width || rfy >= rf_res.height)
-                    connection[i++] = nullptr;
-                else
-                    connection[i++] = &rfs[rfy*rf_res.width+rfx];
+                if(!(rfx < 0 || rfy < 0 || rfx >= rf_res.width || rfy >= rf_res.height)) {
+                    connection.rf[0] = rfy*rf_res.width+rfx;
+                    connection.valid |= 1;
+                }
                 
                 //fancy modulus to keep ky and kx positive values.
                 int ky = (dims.height+(ym%dims.height))%dims.height;
@@ -223,24 +701,34 @@ public:
                 if(bot && rig) potentials.push_back({rfx+1, rfy+1});
 
                 //if the coordinate is valid add a connection;
+                int i = 1;
                 for(auto &j : potentials) {
-                    if(j.x >= 0 && j.x < rf_res.width && j.y >= 0 && j.y < rf_res.height)
-                        connection[i++] = &rfs[j.y*rf_res.width+j.x];
-                    else
-                        connection[i++] = nullptr;
+                    if(j.x >= 0 && j.x < rf_res.width && j.y >= 0 && j.y < rf_res.height) {
+                        connection.rf[i] = j.y*rf_res.width+j.x;
+                        connection.valid |= 1 << i;
+                    }
+                    i++;
                 }
 
             }
         }
+        return true;
     }
 
     inline void update(const int &u, const int &v, const int &p)
     {
-        auto &conxs = cons_map[v*img.cols+u];
-        if(conxs[0]) conxs[0]->add({u, v, p, 1});
-        if(conxs[1]) conxs[1]->add({u, v, p, 0});
-        if(conxs[2]) conxs[2]->add({u, v, p, 0});
-        if(conxs[3]) conxs[3]->add({u, v, p, 0});
+        const links &conxs = cons_map[v*img.cols+u];
+        float *data = (float *)img.data;
+        if(conxs.valid & 1) rfs[conxs.rf[0]].add({u, v, p, 1}, data, img.cols, C);
+        if(conxs.valid & 2) rfs[conxs.rf[1]].add({u, v, p, 0}, data, img.cols, C);
+        if(conxs.valid & 4) rfs[conxs.rf[2]].add({u, v, p, 0}, data, img.cols, C);
+        if(conxs.valid & 8) rfs[conxs.rf[3]].add({u, v, p, 0}, data, img.cols, C);
+    }
+
+    inline void update(const soa_batch &batch)
+    {
+        for(size_t i = 0; i < batch.size(); i++)
+            update(batch.x[i], batch.y[i], batch.p[i]);
     }
 
     cv::Mat getSurface()
@@ -248,22 +736,61 @@ public:
         return img;
     }
 
+    /// \brief on the updating thread, copy the surface for snapshot(), if a
+    /// reader has asked for one since the last publish (or force)
+    void publish(bool force = false)
+    {
+        if(!force && !snapshot_wanted.exchange(false, std::memory_order_relaxed))
+            return;
+        img.copyTo(snapshots.back());
+        snapshots.publish();
+    }
+
+    /// \brief from any one other thread, the most recently published
+    /// surface (see surface::snapshot)
+    bool snapshot(cv::Mat &image)
+    {
+        snapshot_wanted.store(true, std::memory_order_relaxed);
+        if(!snapshots.fresh())
+            return false;
+        snapshots.latest().copyTo(image);
+        return true;
+    }
+
+    /// \brief all the events of receptive field (u, v). Those with c set
+    /// are drawn on the surface, the others only suppress them.
+    ring getRing(int u, int v) const
+    {
+        const CARF &rf = rfs[v*count.width+u];
+        return {rf.points, rf.points + rf.N};
+    }
+
+    /// \brief the drawn events of receptive field (u, v), appended to list
+    void getList(int u, int v, std::vector<cv::Point> &list) const
+    {
+        for(auto &i : getRing(u, v))
+            if(i.c) list.push_back({i.u, i.v});
+    }
+
+    /// \brief all the events of receptive field (u, v), appended to list
+    void getAll(int u, int v, std::vector<cv::Point> &list) const
+    {
+        for(auto &i : getRing(u, v))
+            list.push_back({i.u, i.v});
+    }
+
     std::vector<cv::Point> getList(int u, int v)
     {
         std::vector<cv::Point> p;
-        for(auto &i : rfs[v*count.width+u].points)
-            if(i.c) p.push_back({i.u, i.v});
+        getList(u, v, p);
         return p;
     }
 
-    //THIS COULD BE IMPROVED.
-    //INDEXED BY <U, V> - MAYBE A MORE INTUITIVE WAY
-    //STORE DATA AS std::vector<cv::Point> would result in this being a straight copy 
     std::vector<cv::Point> getAll(int u, int v)
     {
         std::vector<cv::Point> p;
-        for(auto &i : rfs[v*count.width+u].points)
-            p.push_back({i.u, i.v});
+        p.reserve(rfs[v*count.width+u].N);
+        getAll(u, v, p);
         return p;
     }
 
@@ -1,3 +1,8 @@
 #include "core/comms.h"
+#include "core/merge.h"
 #include "core/utilities.h"
+#include "core/metrics.h"
 #include "core/codec.h"
+#include "core/batch.h"
+#include "core/pool.h"
+#include "core/snapshot.h"
@@ -0,0 +1,233 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "event-driven/core/batch.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EV_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ev {
+
+namespace {
+
+using namespace aeWord;
+
+void unpackScalar(const uint32_t *raw, size_t i, size_t n, soa_batch &b)
+{
+    for(; i < n; i++) {
+        uint32_t w = raw[i * words + words - 1];
+        b.x[i] = (w >> x_shift) & x_mask;
+        b.y[i] = (w >> y_shift) & y_mask;
+        b.p[i] = w & 1;
+        b.channel[i] = (w >> c_shift) & 1;
+        if(words == 2) b.ts[i] = raw[i * words] & ts_mask;
+    }
+}
+
+void packScalar(const soa_batch &b, size_t i, size_t n, uint32_t *raw)
+{
+    for(; i < n; i++) {
+        raw[i * words + words - 1] = (b.p[i] & 1) | (b.x[i] & x_mask) << x_shift |
+            (b.y[i] & y_mask) << y_shift | (b.channel[i] & 1u) << c_shift;
+        if(words == 2) raw[i * words] = b.ts[i] & ts_mask;
+    }
+}
+
+#if EV_BATCH_X86
+
+__attribute__((target("avx2")))
+size_t unpackAVX2(const uint32_t *raw, size_t n, soa_batch &b)
+{
+    const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i xm = _mm256_set1_epi32(x_mask), ym = _mm256_set1_epi32(y_mask);
+    const __m256i one = _mm256_set1_epi32(1), tm = _mm256_set1_epi32(ts_mask);
+
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i w;
+        if(words == 1) {
+            w = _mm256_loadu_si256((const __m256i *)(raw + i));
+        } else {
+            //[t0 w0 t1 w1 t2 w2 t3 w3] -> [t0 t1 t2 t3 w0 w1 w2 w3]
+            __m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(raw + 2 * i)), deinterleave);
+            __m256i c = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(raw + 2 * i + 8)), deinterleave);
+            __m256i t = _mm256_and_si256(_mm256_permute2x128_si256(a, c, 0x20), tm);
+            _mm256_storeu_si256((__m256i *)(b.ts.data() + i), t);
+            w = _mm256_permute2x128_si256(a, c, 0x31);
+        }
+
+        __m256i x = _mm256_and_si256(_mm256_srli_epi32(w, x_shift), xm);
+        __m256i y = _mm256_and_si256(_mm256_srli_epi32(w, y_shift), ym);
+        //p in the low 16 bits and channel in the high 16 bits of each pair
+        __m256i pc = _mm256_packus_epi32(_mm256_and_si256(w, one),
+                                         _mm256_and_si256(_mm256_srli_epi32(w, c_shift), one));
+        __m256i xy = _mm256_packus_epi32(x, y);
+        //[x0-3 y0-3 | x4-7 y4-7] -> [x0-7 | y0-7]
+        xy = _mm256_permute4x64_epi64(xy, 0xD8);
+        pc = _mm256_permute4x64_epi64(pc, 0xD8);
+        _mm_storeu_si128((__m128i *)(b.x.data() + i), _mm256_castsi256_si128(xy));
+        _mm_storeu_si128((__m128i *)(b.y.data() + i), _mm256_extracti128_si256(xy, 1));
+        __m128i pc8 = _mm_packus_epi16(_mm256_castsi256_si128(pc), _mm256_extracti128_si256(pc, 1));
+        _mm_storel_epi64((__m128i *)(b.p.data() + i), pc8);
+        _mm_storel_epi64((__m128i *)(b.channel.data() + i), _mm_srli_si128(pc8, 8));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t packAVX2(const soa_batch &b, size_t n, uint32_t *raw)
+{
+    const __m256i xm = _mm256_set1_epi32(x_mask), ym = _mm256_set1_epi32(y_mask);
+    const __m256i one = _mm256_set1_epi32(1), tm = _mm256_set1_epi32(ts_mask);
+
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(b.x.data() + i)));
+        __m256i y = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(b.y.data() + i)));
+        __m256i p = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(b.p.data() + i)));
+        __m256i c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(b.channel.data() + i)));
+        __m256i w = _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(p, one), _mm256_slli_epi32(_mm256_and_si256(x, xm), x_shift)),
+            _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(y, ym), y_shift),
+                            _mm256_slli_epi32(_mm256_and_si256(c, one), c_shift)));
+        if(words == 1) {
+            _mm256_storeu_si256((__m256i *)(raw + i), w);
+        } else {
+            __m256i t = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(b.ts.data() + i)), tm);
+            __m256i lo = _mm256_unpacklo_epi32(t, w);
+            __m256i hi = _mm256_unpackhi_epi32(t, w);
+            _mm256_storeu_si256((__m256i *)(raw + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)(raw + 2 * i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("sse4.1")))
+size_t unpackSSE4(const uint32_t *raw, size_t n, soa_batch &b)
+{
+    const __m128i xm = _mm_set1_epi32(x_mask), ym = _mm_set1_epi32(y_mask);
+    const __m128i one = _mm_set1_epi32(1), tm = _mm_set1_epi32(ts_mask);
+
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128i w;
+        if(words == 1) {
+            w = _mm_loadu_si128((const __m128i *)(raw + i));
+        } else {
+            __m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(raw + 2 * i)));
+            __m128 c = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(raw + 2 * i + 4)));
+            __m128i t = _mm_and_si128(_mm_castps_si128(_mm_shuffle_ps(a, c, _MM_SHUFFLE(2, 0, 2, 0))), tm);
+            _mm_storeu_si128((__m128i *)(b.ts.data() + i), t);
+            w = _mm_castps_si128(_mm_shuffle_ps(a, c, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+
+        __m128i x = _mm_and_si128(_mm_srli_epi32(w, x_shift), xm);
+        __m128i y = _mm_and_si128(_mm_srli_epi32(w, y_shift), ym);
+        __m128i pc = _mm_packus_epi32(_mm_and_si128(w, one),
+                                      _mm_and_si128(_mm_srli_epi32(w, c_shift), one));
+        __m128i xy = _mm_packus_epi32(x, y);
+        _mm_storel_epi64((__m128i *)(b.x.data() + i), xy);
+        _mm_storel_epi64((__m128i *)(b.y.data() + i), _mm_srli_si128(xy, 8));
+        uint8_t pc8[8];
+        _mm_storel_epi64((__m128i *)pc8, _mm_packus_epi16(pc, pc));
+        std::memcpy(b.p.data() + i, pc8, 4);
+        std::memcpy(b.channel.data() + i, pc8 + 4, 4);
+    }
+    return i;
+}
+
+__attribute__((target("sse4.1")))
+size_t packSSE4(const soa_batch &b, size_t n, uint32_t *raw)
+{
+    const __m128i xm = _mm_set1_epi32(x_mask), ym = _mm_set1_epi32(y_mask);
+    const __m128i one = _mm_set1_epi32(1), tm = _mm_set1_epi32(ts_mask);
+
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        int32_t p4, c4;
+        std::memcpy(&p4, b.p.data() + i, 4);
+        std::memcpy(&c4, b.channel.data() + i, 4);
+        __m128i x = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(b.x.data() + i)));
+        __m128i y = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(b.y.data() + i)));
+        __m128i p = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(p4));
+        __m128i c = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(c4));
+        __m128i w = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(p, one), _mm_slli_epi32(_mm_and_si128(x, xm), x_shift)),
+            _mm_or_si128(_mm_slli_epi32(_mm_and_si128(y, ym), y_shift),
+                         _mm_slli_epi32(_mm_and_si128(c, one), c_shift)));
+        if(words == 1) {
+            _mm_storeu_si128((__m128i *)(raw + i), w);
+        } else {
+            __m128i t = _mm_and_si128(_mm_loadu_si128((const __m128i *)(b.ts.data() + i)), tm);
+            _mm_storeu_si128((__m128i *)(raw + 2 * i), _mm_unpacklo_epi32(t, w));
+            _mm_storeu_si128((__m128i *)(raw + 2 * i + 4), _mm_unpackhi_epi32(t, w));
+        }
+    }
+    return i;
+}
+
+enum simdLevel { simd_none, simd_sse4, simd_avx2 };
+
+//detected on first use, as a static initialiser can run before the
+//compiler runtime has detected the cpu
+simdLevel simd()
+{
+    static const simdLevel level = [] {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2")) return simd_avx2;
+        if(__builtin_cpu_supports("sse4.1")) return simd_sse4;
+        return simd_none;
+    }();
+    return level;
+}
+
+#endif
+
+}
+
+void soa_batch::unpack(const AE *data, size_t n)
+{
+    resize(n);
+    const uint32_t *raw = (const uint32_t *)data;
+    size_t i = 0;
+#if EV_BATCH_X86
+    const simdLevel level = simd();
+    if(level == simd_avx2) i = unpackAVX2(raw, n, *this);
+    else if(level == simd_sse4) i = unpackSSE4(raw, n, *this);
+#endif
+    unpackScalar(raw, i, n, *this);
+}
+
+void soa_batch::pack(AE *data) const
+{
+    uint32_t *raw = (uint32_t *)data;
+    const size_t n = size();
+    size_t i = 0;
+#if EV_BATCH_X86
+    const simdLevel level = simd();
+    if(level == simd_avx2) i = packAVX2(*this, n, raw);
+    else if(level == simd_sse4) i = packSSE4(*this, n, raw);
+#endif
+    packScalar(*this, i, n, raw);
+}
+
+}
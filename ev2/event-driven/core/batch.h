@@ -0,0 +1,101 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "utilities.h"
+
+namespace ev {
+
+/// \brief structure-of-arrays copy of ev::AE events. Unpacking from and
+/// packing to ev::AE uses AVX2/SSE4.1 when the CPU supports it, so the
+/// bitfields are decoded 4-8 events at a time. ts is only filled when
+/// ENABLE_TS is set. type, skin and corner are not kept.
+struct soa_batch
+{
+    std::vector<uint16_t> x;
+    std::vector<uint16_t> y;
+    std::vector<uint8_t> p;
+    std::vector<uint8_t> channel;
+    std::vector<uint32_t> ts;
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    void resize(size_t n)
+    {
+        x.resize(n);
+        y.resize(n);
+        p.resize(n);
+        channel.resize(n);
+#if ENABLE_TS
+        ts.resize(n);
+#endif
+    }
+
+    void clear() { resize(0); }
+
+    /// \brief copy event src to position dst, used to compact a batch
+    inline void copy(size_t dst, size_t src)
+    {
+        x[dst] = x[src];
+        y[dst] = y[src];
+        p[dst] = p[src];
+        channel[dst] = channel[src];
+#if ENABLE_TS
+        ts[dst] = ts[src];
+#endif
+    }
+
+    /// \brief time of event i given the time of the final event. Without
+    /// ENABLE_TS all events occur at t_final.
+    inline double time(size_t i, double t_final) const
+    {
+#if ENABLE_TS
+        return t_final - deltaS(ts.back(), ts[i]);
+#else
+        (void)i;
+        return t_final;
+#endif
+    }
+
+    /// \brief replace the batch contents with n events from data
+    void unpack(const AE *data, size_t n);
+
+    /// \brief write the batch as ev::AE to data, which must hold size() events
+    void pack(AE *data) const;
+
+    /// \brief replace the batch contents with the events of a packet
+    template <typename P>
+    void unpack(P &packet)
+    {
+        unpack(packet.size() ? &packet[0] : nullptr, packet.size());
+    }
+
+    /// \brief replace the contents of a packet with the batch
+    template <typename P>
+    void pack(P &packet) const
+    {
+        packet.resize(size());
+        if(size()) pack(&packet[0]);
+    }
+};
+
+}
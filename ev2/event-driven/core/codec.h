@@ -16,6 +16,9 @@
  *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #pragma once
+
+#include <cstddef>
+#include <cstdint>
 namespace ev {
 
 
@@ -44,6 +47,19 @@ typedef struct addressEvent : public timeStamp {
 } addressEvent;
 using AE = addressEvent;
 
+/// \brief the packed ev::AE address word (p:1 x:11 y:10 channel:1 ...), for
+/// code that unpacks events without the bitfields. With ENABLE_TS each event
+/// is preceded by the ts:31 word.
+namespace aeWord {
+constexpr size_t words = sizeof(AE) / sizeof(uint32_t);
+static_assert(sizeof(AE) % sizeof(uint32_t) == 0 && words <= 2, "unexpected ev::AE layout");
+
+constexpr uint32_t x_shift = 1, x_mask = 0x7FF;
+constexpr uint32_t y_shift = 12, y_mask = 0x3FF;
+constexpr uint32_t c_shift = 22;
+constexpr uint32_t ts_mask = 0x7FFFFFFF;
+}
+
 typedef struct encoded : public timeStamp {
     static const std::string tag;
     int32_t data;
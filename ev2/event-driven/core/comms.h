@@ -23,6 +23,7 @@
 #include <yarp/os/ConnectionWriter.h>
 #include <yarp/os/LogStream.h>
 #include <yarp/os/Stamp.h>
+#include <yarp/os/Time.h>
 #include <vector>
 #include <deque>
 #include <list>
@@ -31,7 +32,22 @@
 #include <mutex>
 #include <iomanip>
 #include <condition_variable>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <sstream>
+#include <cstdint>
 #include <fstream>
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <type_traits>
+#include <chrono>
+#include "recording.h"
+#include "shmem.h"
+#include "compress.h"
+#include "trace.h"
+#include "utilities.h"
 
 namespace ev {
 
@@ -42,14 +58,126 @@ typedef struct
     double timestamp;
 } info;
 
+/// \brief what ev::window does with packets once its queue is too old or
+/// too large (see ev::window::setDropPolicy)
+enum dropPolicy { DROP_NONE = 0, DROP_OLDEST, DROP_NEWEST, DROP_DECIMATE };
+
+/// \brief time packets spent queued before an asynchronous ev::BufferedPort
+/// sent them (see ev::BufferedPort::setAsyncWrite)
+typedef struct
+{
+    unsigned int packets;
+    double mean_wait;
+    double max_wait;
+} writeInfo;
+
+
+/// \brief allocator that default-initialises new elements, so growing a
+/// buffer of events does not write zeros that are immediately overwritten
+template <typename T, typename A = std::allocator<T> >
+class default_init_allocator : public A
+{
+    typedef std::allocator_traits<A> a_t;
+public:
+    template <typename U> struct rebind {
+        using other = default_init_allocator<U, typename a_t::template rebind_alloc<U> >;
+    };
+
+    using A::A;
+
+    template <typename U>
+    void construct(U *ptr) noexcept(std::is_nothrow_default_constructible<U>::value)
+    {
+        ::new(static_cast<void *>(ptr)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U *ptr, Args&&... args)
+    {
+        a_t::construct(static_cast<A&>(*this), ptr, std::forward<Args>(args)...);
+    }
+};
+
+/// \brief recycles event buffers between packets of the same type. A new
+/// packet takes the storage of a destroyed one, so ports that create packets
+/// reach a steady-state capacity without allocating.
+template <typename T> class packetPool
+{
+public:
+    using storage = std::vector<T, default_init_allocator<T> >;
+
+    static void take(storage &buffer)
+    {
+        std::lock_guard<std::mutex> lk(mutex());
+        auto &free = buffers();
+        if(free.empty()) return;
+        buffer.swap(free.back());
+        free.pop_back();
+    }
+
+    static void give(storage &buffer)
+    {
+        if(!buffer.capacity()) return;
+        std::lock_guard<std::mutex> lk(mutex());
+        auto &free = buffers();
+        if(free.size() >= max_buffers) return;
+        free.emplace_back();
+        free.back().swap(buffer);
+    }
+
+private:
+    static constexpr size_t max_buffers = 32;
+
+    static std::mutex& mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::vector<storage>& buffers()
+    {
+        static std::vector<storage> free;
+        return free;
+    }
+};
 
 template <typename T> class packet : public yarp::os::Portable {
 
 private:
     unsigned int n_elements{0};
-    std::vector<T> buffer;
+    typename packetPool<T>::storage buffer;
+    T *external{nullptr};
+    //events external can hold when the packet writes to it (wrap)
+    size_t wrapped{0};
     double _duration{0.0};
     yarp::os::Stamp e;
+    bool compress_wire{false};
+    mutable std::vector<uint8_t> wire;
+
+    //latency tracing, only sent when there are hops
+    double _capture{0.0};
+    std::vector<traceHop> hops;
+    mutable std::string trace_wire;
+
+    inline const T* data() const
+    {
+        return external ? external : (const T *)buffer.data();
+    }
+
+    //events that may be changed, so viewed events are copied first
+    inline T* data()
+    {
+        if(external && wrapped) return external;
+        detach();
+        return (T *)buffer.data();
+    }
+
+    //grow geometrically so bursts of events do not reallocate every packet
+    inline void grow(size_t n)
+    {
+        if(buffer.size() >= n) return;
+        buffer.resize(std::max<size_t>({n, buffer.size() * 2, 4096}));
+    }
 
     bool invalidPacket(const std::string &msg) const
     {
@@ -57,24 +185,132 @@ private:
         return false;
     }
 
+    bool readCompressed(yarp::os::ConnectionReader &reader, int n)
+    {
+        if(n <= 0) return invalidPacket("data invalid length");
+        wire.resize(n);
+        if(!reader.expectBlock((char *)wire.data(), n)) return false;
+        n_elements = compressor<T>::count(wire.data(), n);
+        if(!n_elements) return invalidPacket("compressed data invalid");
+        external = nullptr;
+        grow(n_elements);
+        if(!compressor<T>::decode(wire.data(), n, (T *)buffer.data(), n_elements))
+            return invalidPacket("compressed data invalid");
+        return true;
+    }
+
+    bool writeCompressed(yarp::os::ConnectionWriter &writer) const
+    {
+        const std::string &tag = compressor<T>::tag();
+        compressor<T>::encode(data(), n_elements, wire);
+        writer.appendInt32(BOTTLE_TAG_LIST);
+        writer.appendInt32(hops.empty() ? 3 : 4);
+        writer.appendInt32(BOTTLE_TAG_STRING);
+        writer.appendInt32(tag.length());
+        writer.appendExternalBlock(tag.c_str(), tag.length());
+        writer.appendInt32(BOTTLE_TAG_INT32);
+        writer.appendInt32((int)(_duration * 1000000 + 0.5));
+        writer.appendInt32(BOTTLE_TAG_STRING);
+        writer.appendInt32(wire.size());
+        writer.appendExternalBlock((const char *)wire.data(), wire.size());
+        writeTrace(writer);
+        return !writer.isError();
+    }
+
+    //[capture][n] n * ([length][module][written][read])
+    void writeTrace(yarp::os::ConnectionWriter &writer) const
+    {
+        if(hops.empty()) return;
+        trace_wire.assign((const char *)&_capture, sizeof(double));
+        uint32_t n = hops.size();
+        trace_wire.append((const char *)&n, sizeof(n));
+        for(auto &h : hops) {
+            uint32_t length = h.module.size();
+            trace_wire.append((const char *)&length, sizeof(length));
+            trace_wire.append(h.module);
+            trace_wire.append((const char *)&h.written, sizeof(double));
+            trace_wire.append((const char *)&h.read, sizeof(double));
+        }
+        writer.appendInt32(BOTTLE_TAG_STRING);
+        writer.appendInt32(trace_wire.size());
+        writer.appendExternalBlock(trace_wire.data(), trace_wire.size());
+    }
+
+    bool readTrace(yarp::os::ConnectionReader &reader)
+    {
+        if(reader.expectInt32() != BOTTLE_TAG_STRING) return invalidPacket("no trace");
+        int n = reader.expectInt32();
+        if(n < 0) return invalidPacket("trace invalid length");
+        trace_wire.resize(n);
+        if(!reader.expectBlock(&trace_wire[0], n)) return false;
+
+        const char *c = trace_wire.data(), *end = c + n;
+        auto get = [&c, end](void *v, size_t bytes) {
+            if(end - c < (std::ptrdiff_t)bytes) return false;
+            std::memcpy(v, c, bytes);
+            c += bytes;
+            return true;
+        };
+        uint32_t count;
+        if(!get(&_capture, sizeof(double)) || !get(&count, sizeof(count)))
+            return invalidPacket("trace invalid");
+        //each hop is at least a length and two times
+        const size_t min_hop = sizeof(uint32_t) + 2 * sizeof(double);
+        if(count > (size_t)(end - c) / min_hop)
+            return invalidPacket("trace invalid hop count");
+        hops.resize(count);
+        for(auto &h : hops) {
+            uint32_t length;
+            if(!get(&length, sizeof(length)) || end - c < (std::ptrdiff_t)length) return invalidPacket("trace invalid");
+            h.module.assign(c, length);
+            c += length;
+            if(!get(&h.written, sizeof(double)) || !get(&h.read, sizeof(double)))
+                return invalidPacket("trace invalid");
+        }
+        return true;
+    }
+
 public:
 
+    packet()
+    {
+        packetPool<T>::take(buffer);
+    }
+
+    packet(const packet &other) = default;
+    packet& operator=(const packet &other) = default;
+
+    ~packet()
+    {
+        packetPool<T>::give(buffer);
+    }
+
     bool read(yarp::os::ConnectionReader &reader) override
     {
         int32_t r = reader.expectInt32();
         if(r == 0) return false;
         else if(r != BOTTLE_TAG_LIST) return invalidPacket("not a list");
-        if(reader.expectInt32() != 3) return invalidPacket("not 3 elements");
+        int elements = reader.expectInt32();
+        if(elements != 3 && elements != 4) return invalidPacket("not 3 or 4 elements");
+        hops.clear();
         if(reader.expectInt32() != BOTTLE_TAG_STRING) return invalidPacket("no tag");
-        if(reader.expectString() != T::tag) return invalidPacket("incorrect tag");
+        std::string tag = reader.expectString();
+        bool compressed = compressor<T>::available && tag == compressor<T>::tag();
+        if(tag != T::tag && !compressed) return invalidPacket("incorrect tag");
         if(reader.expectInt32() != BOTTLE_TAG_INT32) return invalidPacket("no duration");
         _duration = reader.expectInt32() * 0.000001;
         if(reader.expectInt32() != BOTTLE_TAG_STRING) return invalidPacket("no data");
         int n = reader.expectInt32(); // STRING_LENGTH
-        if(n % sizeof(T)) return invalidPacket("data invalid length");
-        n_elements = n / sizeof(T);
-        if(buffer.size() < n_elements) buffer.resize(n_elements);
-        return reader.expectBlock((char *)buffer.data(), n);
+        if(compressed) {
+            if(!readCompressed(reader, n)) return false;
+        } else {
+            if(n % sizeof(T)) return invalidPacket("data invalid length");
+            n_elements = n / sizeof(T);
+            external = nullptr;
+            grow(n_elements);
+            if(!reader.expectBlock((char *)buffer.data(), n)) return false;
+        }
+        return elements == 3 || readTrace(reader);
     }
 
     bool write(yarp::os::ConnectionWriter &writer) const override
@@ -84,8 +320,11 @@ public:
             return true;
         }
 
+        if(compress_wire && compressor<T>::available && n_elements)
+            return writeCompressed(writer);
+
         writer.appendInt32(BOTTLE_TAG_LIST);
-        writer.appendInt32(3);
+        writer.appendInt32(hops.empty() ? 3 : 4);
         writer.appendInt32(BOTTLE_TAG_STRING);
         writer.appendInt32(T::tag.length());
         writer.appendExternalBlock(T::tag.c_str(), T::tag.length());
@@ -93,38 +332,167 @@ public:
         writer.appendInt32((int)(_duration * 1000000 + 0.5));
         writer.appendInt32(BOTTLE_TAG_STRING);
         writer.appendInt32(n_elements * sizeof(T));
-        writer.appendExternalBlock((char *)buffer.data(), n_elements * sizeof(T));
+        writer.appendExternalBlock((const char *)data(), n_elements * sizeof(T));
+        writeTrace(writer);
         return !writer.isError();
     }
 
+    /// \brief exchange the events and envelope with another packet, without
+    /// copying any events
+    void swap(packet<T> &other)
+    {
+        std::swap(n_elements, other.n_elements);
+        buffer.swap(other.buffer);
+        std::swap(external, other.external);
+        std::swap(wrapped, other.wrapped);
+        std::swap(_duration, other._duration);
+        std::swap(e, other.e);
+        std::swap(compress_wire, other.compress_wire);
+        std::swap(_capture, other._capture);
+        hops.swap(other.hops);
+    }
+
     void clear(void)
     {
         n_elements = 0;
         _duration = 0.0;
+        //a wrapped packet keeps writing to its slot
+        if(!wrapped) external = nullptr;
+        _capture = 0.0;
+        hops.clear();
+    }
+
+    /// \brief record that module is writing the packet now. The first hop
+    /// takes the envelope time as the time the data was captured.
+    void trace(const std::string &module)
+    {
+        double now = yarp::os::Time::now();
+        if(hops.empty()) _capture = e.getTime() > 0.0 ? e.getTime() : now;
+        hops.push_back({module, now, 0.0});
+    }
+
+    /// \brief record that the packet is being read now, if it is traced
+    void traceRead()
+    {
+        if(!hops.empty() && hops.back().read == 0.0)
+            hops.back().read = yarp::os::Time::now();
+    }
+
+    /// \brief continue the trace of the packet the events came from
+    template <typename U>
+    void inheritTrace(const packet<U> &source)
+    {
+        _capture = source.captureTime();
+        hops = source.traceHops();
+    }
+
+    bool isTraced() const
+    {
+        return !hops.empty();
+    }
+
+    double captureTime() const
+    {
+        return _capture;
+    }
+
+    const std::vector<traceHop>& traceHops() const
+    {
+        return hops;
+    }
+
+    /// \brief refer to n events stored elsewhere (e.g. shared memory) instead
+    /// of copying them. The events must outlive the view and are not
+    /// modified by the packet: the const accessors read them in place, while
+    /// the non-const accessors and any change first copy them with detach().
+    void view(const T *events, size_t n)
+    {
+        external = const_cast<T *>(events);
+        wrapped = 0;
+        n_elements = n;
+    }
+
+    /// \brief write events straight to storage elsewhere (e.g. a shared
+    /// memory slot) instead of the packet's own buffer. The packet is emptied,
+    /// and clear() keeps it wrapped. Once more than capacity events are added
+    /// they are copied to the packet's own storage with detach().
+    void wrap(T *events, size_t capacity)
+    {
+        external = events;
+        wrapped = capacity;
+        n_elements = 0;
+    }
+
+    /// \brief copy viewed events into the packet's own storage
+    void detach()
+    {
+        if(!external) return;
+        grow(n_elements);
+        if(n_elements) std::memcpy((char *)buffer.data(), (const char *)external, n_elements * sizeof(T));
+        external = nullptr;
+        wrapped = 0;
+    }
+
+    bool isView() const
+    {
+        return external && !wrapped;
+    }
+
+    /// \brief send this packet in the compressed format of ev::compressor,
+    /// if there is one for T. Readers decompress transparently.
+    void compress(bool enable = true)
+    {
+        compress_wire = enable;
+    }
+
+    bool isCompressed() const
+    {
+        return compress_wire && compressor<T>::available;
     }
 
     void push_back(const T &element)
     {
+        if(external && n_elements < wrapped) {
+            external[n_elements++] = element;
+            return;
+        }
+        detach();
         if(buffer.size() <= n_elements)
-            buffer.resize(buffer.size() + 16384);
+            grow(n_elements + 1);
         buffer[n_elements++] = element;
     }
 
-    using iterator = typename std::vector<T>::iterator;
+    using iterator = T*;
+    using const_iterator = const T*;
 
-    typename std::vector<T>::iterator begin()
+    iterator begin()
     {
-        return buffer.begin();
+        return data();
     }
 
-    typename std::vector<T>::iterator end()
+    iterator end()
     {
-        return buffer.begin() + n_elements;
+        return data() + n_elements;
+    }
+
+    const_iterator begin() const
+    {
+        return data();
+    }
+
+    const_iterator end() const
+    {
+        return data() + n_elements;
     }
 
     T& operator[](std::size_t index)
     {
-        return buffer[index];
+        return data()[index];
+    }
+
+    const T& operator[](std::size_t index) const
+    {
+        return data()[index];
     }
 
     size_t size(void) const
@@ -134,9 +502,31 @@ public:
 
     void size(int n)
     {
+        if(external && (size_t)n <= wrapped) return;
+        detach();
         buffer.resize(n);
     }
 
+    /// \brief set the number of events in the packet, growing the buffer if
+    /// needed. Existing events are kept.
+    void resize(size_t n)
+    {
+        if(external && n <= wrapped) {
+            n_elements = n;
+            return;
+        }
+        detach();
+        grow(n);
+        n_elements = n;
+    }
+
+    /// \brief make sure n events fit without reallocating
+    void reserve(size_t n)
+    {
+        if(external && n <= wrapped) return;
+        if(buffer.size() < n) buffer.resize(n);
+    }
+
     void duration(const double &seconds)
     {
         _duration = seconds;
@@ -162,18 +552,25 @@ public:
         return e;
     }
 
+    inline const yarp::os::Stamp& envelope() const
+    {
+        return e;
+    }
+
     int fillFromMemory(const char *s, int bytes)
     {
         n_elements = bytes / sizeof(T);
-        buffer.resize(n_elements);
+        external = nullptr;
+        grow(n_elements);
         memcpy((char *)buffer.data(), s, n_elements * sizeof(T));
         return n_elements * sizeof(T);
     }
 
     int fillFromDevice(const int fd, const int min_packet_size, const int max_packet_size)
     {
+        external = nullptr;
         if(buffer.size() * sizeof(T) < max_packet_size)
-            buffer.resize(max_packet_size / sizeof(T) + (max_packet_size % sizeof(T) ? 1 : 0));
+            reserve(max_packet_size / sizeof(T) + (max_packet_size % sizeof(T) ? 1 : 0));
 
         int r = min_packet_size;
         unsigned int n_bytes_read = 0;
@@ -195,13 +592,15 @@ public:
 
     int singleDeviceRead(const int fd) 
     {
-        int max_packet_size = buffer.size() * sizeof(T);
+        //a wrapped packet reads straight into its storage
+        char *events = (char *)data();
+        int max_packet_size = (external ? wrapped : buffer.size()) * sizeof(T);
         int n_bytes_read = this->size() * sizeof(T);
         
         int r = -1;
         while(r < 0) 
         { 
-            r = ::read(fd, (char *)buffer.data() + n_bytes_read, max_packet_size - n_bytes_read);
+            r = ::read(fd, events + n_bytes_read, max_packet_size - n_bytes_read);
             if(r < 0)
                 yInfo() << "[READ ]" << std::strerror(errno);
         }
@@ -221,7 +620,7 @@ public:
         size_t written = 0;
         while(written < bytes_to_write) {
 
-            int r = ::write(fd, (char *)buffer.data() + written, bytes_to_write - written);
+            int r = ::write(fd, (const char *)data() + written, bytes_to_write - written);
 
             if(r > 0) { //success!
                 written += r;
@@ -241,6 +640,96 @@ template <typename T> class BufferedPort : protected yarp::os::BufferedPort< ev:
 {
 private:
     ev::packet<T> *prepared = nullptr;
+
+    //shared memory transport between processes on the same host
+    shmemWriter<T> shared_writer;
+    shmemReader<T> shared_reader;
+    ev::packet<T> shared_packet;
+
+    bool compress_wire{false};
+
+    //latency tracing
+    std::string trace_module;
+    traceCollector *collector{nullptr};
+
+    //asynchronous writing. The sender thread sends packets [async_tail,
+    //async_head) while the next one is prepared in slot async_head.
+    std::vector< ev::packet<T> > async_slots;
+    std::vector< std::chrono::steady_clock::time_point > async_queued;
+    size_t async_depth{0};
+    std::atomic<size_t> async_head{0};
+    std::atomic<size_t> async_tail{0};
+    std::atomic<bool> async_stop{false};
+    std::thread async_thread;
+
+    //only used to sleep when there is nothing to do
+    std::mutex async_m;
+    std::condition_variable async_signal;
+    std::atomic<bool> sender_waiting{false};
+    std::atomic<bool> producer_waiting{false};
+
+    //wait statistics, reset by writeStats()
+    std::atomic<unsigned int> async_packets{0};
+    std::atomic<int64_t> async_wait_ns{0};
+    std::atomic<int64_t> async_max_ns{0};
+
+    inline ev::packet<T>& asyncSlot(size_t i)
+    {
+        return async_slots[i % async_slots.size()];
+    }
+
+    inline bool asyncFull()
+    {
+        return async_head.load() - async_tail.load() >= async_depth;
+    }
+
+    void asyncRun()
+    {
+        using clock = std::chrono::steady_clock;
+        while(true) {
+            if(async_tail.load() == async_head.load() && !async_stop) {
+                std::unique_lock<std::mutex> lk(async_m);
+                sender_waiting = true;
+                async_signal.wait(lk, [this]{return async_tail.load() != async_head.load() || async_stop;});
+                sender_waiting = false;
+            }
+            if(async_stop) break;
+
+            size_t t = async_tail.load();
+            int64_t wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               clock::now() - async_queued[t % async_queued.size()]).count();
+            async_packets++;
+            async_wait_ns += wait;
+            int64_t longest = async_max_ns.load();
+            while(wait > longest && !async_max_ns.compare_exchange_weak(longest, wait));
+
+            //the port's packet takes the events and leaves its storage behind
+            //for reuse
+            auto &p = yarp::os::BufferedPort< ev::packet<T> >::prepare();
+            p.swap(asyncSlot(t));
+            yarp::os::BufferedPort< ev::packet<T> >::setEnvelope(p.envelope());
+            yarp::os::BufferedPort< ev::packet<T> >::waitForWrite();
+            yarp::os::BufferedPort< ev::packet<T> >::writeStrict();
+
+            async_tail.store(t + 1);
+            if(producer_waiting) {
+                std::lock_guard<std::mutex> lk(async_m);
+                async_signal.notify_all();
+            }
+        }
+    }
+
+    void asyncClose()
+    {
+        if(!async_thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lk(async_m);
+            async_stop = true;
+            async_signal.notify_all();
+        }
+        async_thread.join();
+    }
+
 public:
 
     BufferedPort()
@@ -248,6 +737,90 @@ public:
         yarp::os::BufferedPort< ev::packet<T> >::setStrict();
     }
 
+    ~BufferedPort()
+    {
+        asyncClose();
+    }
+
+    /// \brief send packets through the shared memory ring name instead of a
+    /// yarp port. prepare() waits for a free slot and returns a packet that
+    /// fills it in place, so write() publishes it without copying. Packets
+    /// that grow beyond slot_events are copied and split across slots.
+    bool openSharedWriter(const std::string &name, unsigned int slots = 32, size_t slot_events = 32768)
+    {
+        return shared_writer.open(name, slots, slot_events);
+    }
+
+    /// \brief receive packets from the shared memory ring name. read()
+    /// returns a view of the writer's slot, valid until the next read().
+    /// Reading it as a const packet uses the events in place, non-const
+    /// access first copies them into the packet.
+    bool openSharedReader(const std::string &name)
+    {
+        return shared_reader.open(name);
+    }
+
+    /// \brief send packets in the compressed wire format (see
+    /// ev::compressor). Any ev::BufferedPort or ev::window can read them.
+    void setCompression(bool enable = true)
+    {
+        compress_wire = enable;
+    }
+
+    /// \brief send packets from a separate thread, with up to depth packets
+    /// queued. write() then only waits if depth packets are still queued, so
+    /// a slow or bursty connection does not stall the thread producing the
+    /// data. 0 sends from the calling thread. Call before the first prepare().
+    void setAsyncWrite(unsigned int depth)
+    {
+        asyncClose();
+        async_depth = depth;
+        async_head = async_tail = 0;
+        async_stop = false;
+        if(!depth) return;
+        async_slots.resize(depth + 1);
+        async_queued.resize(depth + 1);
+        async_thread = std::thread([this]{asyncRun();});
+    }
+
+    /// \brief add a hop for module to each packet written, so the latency of
+    /// each module can be measured downstream (see ev::traceCollector).
+    /// An empty module turns tracing off.
+    void setTrace(const std::string &module)
+    {
+        trace_module = module;
+    }
+
+    /// \brief give the hops of traced packets that are read to collector
+    void setTraceCollector(traceCollector *collector)
+    {
+        this->collector = collector;
+    }
+
+    /// \brief how long packets were queued before being sent since the last
+    /// call, when sending asynchronously
+    writeInfo writeStats()
+    {
+        unsigned int n = async_packets.exchange(0);
+        double total = async_wait_ns.exchange(0) * 1e-9;
+        double longest = async_max_ns.exchange(0) * 1e-9;
+        return {n, n ? total / n : 0.0, longest};
+    }
+
+    /// \brief packets waiting for the sending thread, when sending
+    /// asynchronously
+    size_t queued()
+    {
+        return async_head.load() - async_tail.load();
+    }
+
+    bool isWriting()
+    {
+        if(shared_writer.isOpen()) return false;
+        if(async_depth) return asyncFull();
+        return yarp::os::BufferedPort< ev::packet<T> >::isWriting();
+    }
+
     void write()
     {
         //we don't really want packets to "build up" in the outgoing thread.
@@ -260,6 +833,25 @@ public:
                         "Nothing written";
             return;
         }
+        if(!trace_module.empty())
+            prepared->trace(trace_module);
+        if(shared_writer.isOpen()) {
+            shared_writer.write(*prepared);
+            prepared = nullptr;
+            return;
+        }
+        if(async_depth) {
+            prepared = nullptr;
+            if(async_stop) return;
+            size_t h = async_head.load();
+            async_queued[h % async_queued.size()] = std::chrono::steady_clock::now();
+            async_head.store(h + 1);
+            if(sender_waiting) {
+                std::lock_guard<std::mutex> lk(async_m);
+                async_signal.notify_all();
+            }
+            return;
+        }
         yarp::os::BufferedPort< ev::packet<T> >::setEnvelope(prepared->envelope());
         yarp::os::BufferedPort< ev::packet<T> >::waitForWrite(); 
         yarp::os::BufferedPort< ev::packet<T> >::writeStrict();
@@ -268,8 +860,29 @@ public:
 
     ev::packet<T>& prepare() 
     {
+        if(shared_writer.isOpen()) {
+            shared_packet.clear();
+            shared_writer.prepare(shared_packet);
+            prepared = &shared_packet;
+            return shared_packet;
+        }
+        if(async_depth) {
+            //only waits when depth packets are already queued
+            if(asyncFull() && !async_stop) {
+                std::unique_lock<std::mutex> lk(async_m);
+                producer_waiting = true;
+                async_signal.wait(lk, [this]{return !asyncFull() || async_stop;});
+                producer_waiting = false;
+            }
+            auto &p = asyncSlot(async_head.load());
+            p.clear();
+            p.compress(compress_wire);
+            prepared = &p;
+            return p;
+        }
         auto &p = yarp::os::BufferedPort< ev::packet<T> >::prepare();
         p.clear();
+        p.compress(compress_wire);
         prepared = &p;
         return p;
     }
@@ -277,23 +890,80 @@ public:
     bool unprepare()
     {
         prepared = nullptr;
+        if(shared_writer.isOpen() || async_depth) return true;
         return yarp::os::BufferedPort< ev::packet<T> >::unprepare();
     }
 
     ev::packet<T>* read(bool shouldWait = true) 
     {
+        if(shared_reader.isOpen())
+            return shared_reader.read(shared_packet, shouldWait) ? &shared_packet : nullptr;
         ev::packet<T>* result = yarp::os::BufferedPort<ev::packet<T> >::read(shouldWait);
         if(result) yarp::os::BufferedPort< ev::packet<T> >::getEnvelope(result->envelope());
+        if(result && result->isTraced()) {
+            result->traceRead();
+            if(collector)
+                collector->add(result->captureTime(), result->traceHops(), yarp::os::Time::now());
+        }
         return result;
     }
 
+    void close()
+    {
+        asyncClose();
+        shared_writer.close();
+        shared_reader.close();
+        yarp::os::BufferedPort< ev::packet<T> >::close();
+    }
+
+    void interrupt()
+    {
+        if(async_depth) {
+            std::lock_guard<std::mutex> lk(async_m);
+            async_stop = true;
+            async_signal.notify_all();
+        }
+        shared_writer.interrupt();
+        shared_reader.interrupt();
+        yarp::os::BufferedPort< ev::packet<T> >::interrupt();
+    }
+
+    void resume()
+    {
+        if(async_depth && async_stop) {
+            asyncClose();
+            async_stop = false;
+            async_thread = std::thread([this]{asyncRun();});
+        }
+        shared_writer.resume();
+        shared_reader.resume();
+        yarp::os::BufferedPort< ev::packet<T> >::resume();
+    }
+
+    bool isClosed()
+    {
+        if(shared_writer.isOpen() || shared_reader.isOpen()) return false;
+        return yarp::os::BufferedPort< ev::packet<T> >::isClosed();
+    }
+
     using yarp::os::BufferedPort< ev::packet<T> >::open;
     using yarp::os::BufferedPort< ev::packet<T> >::getPendingReads;
-    using yarp::os::BufferedPort< ev::packet<T> >::close;
-    using yarp::os::BufferedPort< ev::packet<T> >::interrupt;
-    using yarp::os::BufferedPort< ev::packet<T> >::resume;
-    using yarp::os::BufferedPort< ev::packet<T> >::isWriting;
-    using yarp::os::BufferedPort< ev::packet<T> >::isClosed;
+};
+
+/// \brief wakes a thread that waits on the data of several windows, see
+/// window::notify()
+struct dataSignal
+{
+    std::mutex m;
+    std::condition_variable cv;
+    std::atomic<int> waiting{0};
+
+    void notify()
+    {
+        if(!waiting) return;
+        std::lock_guard<std::mutex> lk(m);
+        cv.notify_all();
+    }
 };
 
 template <typename T> class window : public yarp::os::Thread
@@ -309,20 +979,22 @@ public:
         using reference         = T&;
 
         iterator() : m_ptr() {}
-        void setAsEnd(typename std::list< packet<T>* >::iterator last)
+        void setAsEnd(const window *w, size_t last)
         {
-            m_ptr = (**last).end();
-            _timestamp = (*last)->timestamp();
-            _id = (*last)->id();
+            m_ptr = w->events(last) + w->slot(last).size();
+            _timestamp = w->slot(last).timestamp();
+            _id = w->slot(last).id();
         }
 
-        void setAsStart(typename std::list< packet<T>* >::iterator first, typename std::list< packet<T>* >::iterator last)
+        void setAsStart(const window *w, size_t first, size_t last, size_t offset = 0)
         {
-            m_ptr = (**first).begin();
-            packet_it = first;
+            owner = w;
+            m_ptr = w->events(first) + offset;
+            m_end = w->events(first) + w->slot(first).size();
+            packet_i = first;
             final = last;
-            _timestamp = (*first)->timestamp();
-            _id = (*first)->id();
+            _timestamp = w->slot(first).timestamp();
+            _id = w->slot(first).id();
         }
 
         //here we always return the "packet timestamp" if the user wants to use
@@ -344,11 +1016,8 @@ public:
         {
 
             m_ptr++;
-            if(m_ptr == (*packet_it)->end() && packet_it != final) {
-                m_ptr = (*(++packet_it))->begin();
-                _timestamp = (*packet_it)->timestamp();
-                _id = (*packet_it)->id();
-            }
+            if(m_ptr == m_end && packet_i != final)
+                nextPacket();
 
             return *this;
         }
@@ -358,11 +1027,8 @@ public:
             //TODO - check this is a good method (this += k?)
             //for (auto i = 0; i < k; i++) {
                 m_ptr++;
-                if (m_ptr == (*packet_it)->end() && packet_it != final) {
-                    m_ptr = (*(++packet_it))->begin();
-                    _timestamp = (*packet_it)->timestamp();
-                    _id = (*packet_it)->id();
-                }
+                if (m_ptr == m_end && packet_i != final)
+                    nextPacket();
             //}
 
             return *this;
@@ -376,8 +1042,19 @@ public:
         int _id{0};
         double _timestamp{0.0};
         typename packet<T>::iterator m_ptr;
-        typename std::list< packet<T>* >::iterator packet_it;
-        typename std::list< packet<T>* >::iterator final;
+        typename packet<T>::iterator m_end{nullptr};
+        const window *owner{nullptr};
+        size_t packet_i{0};
+        size_t final{0};
+
+        void nextPacket()
+        {
+            const packet<T> &p = owner->slot(++packet_i);
+            m_ptr = owner->events(packet_i);
+            m_end = m_ptr + p.size();
+            _timestamp = p.timestamp();
+            _id = p.id();
+        }
     };
 
     iterator begin() { return _begin; }
@@ -389,74 +1066,84 @@ public:
     //number of packets in the window
     packet<T>* readPacket(bool blocking = true)
     {
-        std::unique_lock<std::mutex> lk(m);
         _removeAlreadyRead();
 
         if(blocking)
-            signal.wait(lk, [this]{return in_port.count > 0;});
+            _wait([this]{return in_port.count > 0;});
+        else
+            _receive();
+        _dropOldest();
 
-        if(active.empty()) 
+        size_t first = tail().load();
+        if(first == received) 
         {
-            _resetIterators(active.begin(), active.begin());
+            _resetIterators(first, first);
             in_window = {0, 0, 0};
             return nullptr;
         } 
         else
         {
-            _resetIterators(active.begin(), std::next(active.begin()));
-            in_window = {(unsigned int)(**active.begin()).size(), 
-                        (**active.begin()).duration(), 
-                        (**active.begin()).timestamp()};
-            return *active.begin();
+            _resetIterators(first, first + 1);
+            in_window = {(unsigned int)slot(first).size(), 
+                        slot(first).duration(), 
+                        slot(first).timestamp()};
+            return &slot(first);
         }
     }
 
     info readAll(bool blocking = true)
     {
-        //enter critical section
-        std::unique_lock<std::mutex> lk(m);
-
         //remove all the old data
         _removeAlreadyRead();
 
         //if blocking wait for some data
         if(blocking)
-            signal.wait(lk, [this]{return in_port.count > 0 || isStopping();});
+            _wait([this]{return in_port.count > 0;});
+        else
+            _receive();
+        _dropOldest();
 
         //set the new window for all data
-        _resetIterators(active.begin(), active.end());
+        _resetIterators(tail().load(), received);
         in_window = in_port;
 
         return in_window;
 
     }
 
+    /// \brief the most recent seconds of data. With ENABLE_TS the window
+    /// starts at the first event inside the interval, otherwise at the start
+    /// of the oldest packet needed to cover it.
     info readSlidingWinT(double seconds, bool blocking = true)
     {
-        std::unique_lock<std::mutex> lk(m);
-
         if(blocking) 
-            signal.wait(lk, [this]{return in_port.count > in_window.count || isStopping();});
+            _wait([this]{return in_port.count > in_window.count + trimmed.count;});
+        else
+            _receive();
         
          //pop packets until we find the desired temporal window
-        while(!active.empty())
+        while(tail().load() != received)
         {
-            //get the first packet in the active queue stats
-            auto packet_duration = (**active.begin()).duration();
-            auto packet_count =  (**active.begin()).size();
-
             //if we can remove the packet and stay in the correct time do it
-            if(in_port.duration - packet_duration < seconds)
+            if(in_port.duration - slot(tail().load()).duration() < seconds)
                 break;
-            in_port.duration -= packet_duration;
-            in_port.count -= packet_count;
-            inactive.push_back(*active.begin());
-            active.pop_front();
+            _pop();
         }
 
+#if ENABLE_TS
+        size_t offset = _firstInTime(seconds, std::is_base_of<timeStamp, T>());
+#else
+        size_t offset = 0;
+#endif
+
         //set the correct iterators
-        _resetIterators(active.begin(), active.end());
+        _resetIterators(tail().load(), received, offset);
         in_window = in_port;
+        if(offset) {
+            trimmed = {(unsigned int)offset, std::max(in_port.duration - seconds, 0.0), 0.0};
+            in_window.count -= trimmed.count;
+            in_window.duration -= trimmed.duration;
+        }
 
         return in_window;
     }
@@ -464,66 +1151,64 @@ public:
     info readSlidingWinT(double seconds, double exact_time)
     {
         //ensure that time has passed in this port
-        std::unique_lock<std::mutex> lk(m);
-        signal.wait(lk, [this, &exact_time]{return (in_port.count && in_port.timestamp >= exact_time) || isStopping();});
+        _wait([this, &exact_time]{return in_port.count && in_port.timestamp >= exact_time;});
 
          //pop packets until we find the desired temporal window less than the exact time
-        while(!active.empty())
+        while(tail().load() != received)
         {
-            //get the first packet in the active queue stats
-            auto packet_duration = (**active.begin()).duration();
-            auto packet_count =  (**active.begin()).size();
-            auto packet_timestamp = (**active.begin()).timestamp();
-
             //if we can remove the packet and stay in the correct time do it
-            if(packet_timestamp + seconds >= exact_time)
+            if(slot(tail().load()).timestamp() + seconds >= exact_time)
                 break;
-            in_port.duration -= packet_duration;
-            in_port.count -= packet_count;
-            inactive.push_back(*active.begin());
-            active.pop_front();
+            _pop();
         }
 
         in_window = {0, 0.0, 0.0};
-        auto i = active.begin();
+        size_t i = tail().load();
+        if(i == received) {
+            _resetIterators(i, i);
+            return in_window;
+        }
         do {
-            in_window.duration += (**i).duration();
-            in_window.count +=  (**i).size();
-            in_window.timestamp = (**i).timestamp();
+            in_window.duration += slot(i).duration();
+            in_window.count +=  slot(i).size();
+            in_window.timestamp = slot(i).timestamp();
             i++;
-        } while(i != active.end() && (**i).timestamp() < exact_time);
+        } while(i != received && slot(i).timestamp() < exact_time);
 
         //set the correct iterators
-        _resetIterators(active.begin(), i);
+        _resetIterators(tail().load(), i);
 
         return in_window;
     }
 
+    /// \brief the most recent count events, starting at the exact
+    /// count-th newest event
     info readSlidingWinN(unsigned int count, bool blocking = true)
     {
-        std::unique_lock<std::mutex> lk(m);
         if(blocking) 
-            signal.wait(lk, [this]{return  in_port.count > in_window.count || isStopping();});
+            _wait([this]{return in_port.count > in_window.count + trimmed.count;});
+        else
+            _receive();
 
          //pop packets until we find the desired fixed-count window
-        while(!active.empty())
+        while(tail().load() != received)
         {
-            //get the first packet in the active queue stats
-            auto packet_duration = (**active.begin()).duration();
-            auto packet_count =  (**active.begin()).size();
-
             //if we can remove the packet and stay in the correct time do it
-            if(in_port.count - packet_count < count)
+            if(in_port.count - slot(tail().load()).size() < count)
                 break;
-            in_port.duration -= packet_duration;
-            in_port.count -= packet_count;
-            inactive.push_back(*active.begin());
-            active.pop_front();
+            _pop();
         }
 
+        //the oldest packet can hold more events than needed
+        size_t offset = in_port.count > count ? in_port.count - count : 0;
+
         //set the correct iterators
-        _resetIterators(active.begin(), active.end());
+        _resetIterators(tail().load(), received, offset);
         in_window = in_port;
+        if(offset) {
+            trimmed = {(unsigned int)offset, 0.0, 0.0};
+            in_window.count -= trimmed.count;
+        }
 
         return in_window;
     }
@@ -531,32 +1216,32 @@ public:
     info readChunkN(unsigned int count, bool blocking = true)
     {
         //first of all remove all the old stuff
-        std::unique_lock<std::mutex> lk(m);
         _removeAlreadyRead();
 
         //if we are blocking on a condition then wait till we have enough data
         if(blocking) {
-            while(in_port.count < count) {
-                signal.wait(lk);
-                if(isStopping()) return {0, 0, 0};
-            }
+            _wait([this, count]{return in_port.count >= count;});
+            if(in_port.count < count) return {0, 0, 0};
+        } else {
+            _receive();
         }
+        _dropOldest();
 
         //move the iterator until we find our condition, or no more data
         in_window = {0, 0, 0};
-        last_packet = active.begin();
-        while(last_packet != active.end()) {
-            in_window.duration += (**last_packet).duration();
-            in_window.count += (**last_packet).size();
-            in_window.timestamp = (**last_packet).timestamp();
-            last_packet++;
+        size_t i = tail().load();
+        while(i != received) {
+            in_window.duration += slot(i).duration();
+            in_window.count += slot(i).size();
+            in_window.timestamp = slot(i).timestamp();
+            i++;
 
             if(in_window.count >= count)
                 break;
         }
 
         //set the new window for all data
-        _resetIterators(active.begin(), last_packet);
+        _resetIterators(tail().load(), i);
 
         return in_window;
     }
@@ -564,50 +1249,52 @@ public:
     info readChunkT(float seconds, bool blocking = true)
     {
         //first of all remove all the old stuff
-        std::unique_lock<std::mutex> lk(m);
         _removeAlreadyRead();
 
         //if we are blocking on a condition then wait till we have enough data
         if(blocking) {
-            while(in_port.duration < seconds) {
-                signal.wait(lk);
-                if(isStopping()) return {0, 0, 0};
-            }
+            _wait([this, seconds]{return in_port.duration >= seconds;});
+            if(in_port.duration < seconds) return {0, 0, 0};
+        } else {
+            _receive();
         }
+        _dropOldest();
 
         //move the iterator until we find our condition, or no more data
         in_window = {0, 0, 0};
-        last_packet = active.begin();
-        while(last_packet != active.end()) {
-            in_window.duration += (**last_packet).duration();
-            in_window.count += (**last_packet).size();
-            in_window.timestamp = (**last_packet).timestamp();
-            last_packet++;
+        size_t i = tail().load();
+        while(i != received) {
+            in_window.duration += slot(i).duration();
+            in_window.count += slot(i).size();
+            in_window.timestamp = slot(i).timestamp();
+            i++;
 
             if(in_window.duration >= seconds)
                 break;
         }
 
         //set the new window for all data
-        _resetIterators(active.begin(), last_packet);
+        _resetIterators(tail().load(), i);
 
         return in_window;
     }
 
-    window()
+    /// \brief max_packets is the number of packets that can be queued before
+    /// the receiving thread waits for the reader (rounded up to a power of 2)
+    explicit window(unsigned int max_packets = 4096) : src(std::make_shared<ring>(max_packets))
     {
-        first_packet = active.begin();
-        last_packet = active.begin();
     }
 
     ~window()
     {
         stop();
         port.close();
-        for(auto i = active.begin(); i != active.end(); i++)
-            delete *i;
-        for(auto i = inactive.begin(); i != inactive.end(); i++)
-            delete *i;
+        std::atomic_store(&src->listeners[cursor], std::shared_ptr<dataSignal>());
+        std::lock_guard<std::mutex> lk(src->m);
+        src->tails[cursor] = SIZE_MAX;
+        src->view_tails[cursor] = SIZE_MAX;
+        if(src->sharing) src->releaseShared();
+        src->space_signal.notify_all();
     }
 
     info stats_current(void) const
@@ -617,8 +1304,8 @@ public:
 
     info stats_unprocessed(void) const
     {
-        return {in_port.count - in_window.count,
-                in_port.duration - in_window.duration,
+        return {in_port.count - in_window.count - trimmed.count,
+                in_port.duration - in_window.duration - trimmed.duration,
                 in_port.timestamp};
     }
 
@@ -627,47 +1314,181 @@ public:
         return in_port;
     }
 
-    bool open(const std::string name)
+    /// \brief bound the latency of unread data. Once the unread packets span
+    /// more than max_age seconds or hold more than max_events events, the
+    /// policy drops the oldest unread packets (when the data is read), drops
+    /// incoming packets, or keeps every second event of incoming packets.
+    /// Incoming packets are also dropped, instead of waiting, when the queue
+    /// is full. Call before open().
+    void setDropPolicy(dropPolicy policy, double max_age, unsigned int max_events = UINT_MAX)
     {
-        if(!port.open(name)) {
-            yError() << "Could not open port: " << name;
-            return false;
-        }
-        return this->start();
+        this->policy = policy;
+        this->max_age = max_age > 0.0 ? max_age : DBL_MAX;
+        this->max_events = max_events;
     }
 
-    void interrupt()
+    /// \brief give the hops of traced packets to collector as they are read
+    void setTraceCollector(traceCollector *collector)
     {
-        port.interrupt();
+        this->collector = collector;
+    }
+
+    /// \brief packets fully discarded by the drop policy
+    size_t droppedPackets() const
+    {
+        return dropped_packets + src->rejected_packets;
+    }
+
+    /// \brief events discarded by the drop policy, including decimation
+    size_t droppedEvents() const
+    {
+        return dropped_events + src->rejected_events;
+    }
+
+    /// \brief packets received but not yet released by this window
+    size_t queuedPackets() const
+    {
+        return src->head - tail();
+    }
+
+    /// \brief events received but not yet released by this window
+    size_t queuedEvents() const
+    {
+        return src->queued_events - src->released[cursor];
+    }
+
+    /// \brief seconds between the newest packet received and the newest
+    /// packet given to the reader
+    double lag() const
+    {
+        return std::max(src->newest_received.load() - newest_read.load(), 0.0);
+    }
+
+    bool open(const std::string name)
+    {
+        if(!port.open(name)) {
+            yError() << "Could not open port: " << name;
+            return false;
+        }
+        src->closed = false;
+        return this->start();
+    }
+
+    /// \brief read the packets received by source, which must be open,
+    /// instead of opening another port. Each window keeps its own read
+    /// position and windows, and a packet is only reused once every window
+    /// has passed it. Drop policies that act on incoming packets follow the
+    /// source's policy.
+    bool share(window<T> &source)
+    {
+        std::shared_ptr<ring> r = source.src;
+        std::lock_guard<std::mutex> lk(r->m);
+        unsigned int i = 1;
+        while(i < ring::max_readers && r->tails[i] != SIZE_MAX) i++;
+        if(i == ring::max_readers) {
+            yError() << "Too many windows sharing the same input";
+            return false;
+        }
+        r->released[i] = r->queued_events.load();
+        r->tails[i] = r->head.load();
+        r->view_tails[i] = r->tails[i].load();
+        src = r;
+        cursor = i;
+        received = first_packet = last_packet = src->tails[i];
+        //the thread only waits to be stopped, so isRunning() and stop()
+        //behave as for open()
+        return this->start();
+    }
+
+    /// \brief read from the shared memory ring name (see
+    /// ev::BufferedPort::openSharedWriter) instead of a yarp port. Packets
+    /// are read in place, and a slot is given back to the writer once every
+    /// window sharing this input has passed it. A window that holds more than
+    /// half of the slots copies its oldest packets when it next reads, so
+    /// that a long window does not stop the writer. A window that stops
+    /// reading makes the writer wait once it holds every slot, rather than
+    /// after max_packets. The events must not be modified.
+    bool openShared(const std::string name)
+    {
+        if(!src->shared.open(name))
+            return false;
+        src->sharing = true;
+        src->closed = false;
+        return this->start();
+    }
+
+    /// \brief also notify signal when a packet arrives or the input stops,
+    /// so that one thread can sleep until any of several windows has data.
+    /// Call after open() or share().
+    void notify(std::shared_ptr<dataSignal> signal)
+    {
+        std::atomic_store(&src->listeners[cursor], signal);
+        if(signal) src->listening = true;
+    }
+
+    /// \brief the window is stopped or its input has closed, no more packets
+    /// will arrive
+    bool closed()
+    {
+        return _stopped();
+    }
+
+    void interrupt()
+    {
+        port.interrupt();
+        if(!cursor) src->shared.interrupt();
     }
 
     void resume()
     {
         port.resume();
+        if(!cursor) src->shared.resume();
     }
 
     void onStop()
     {
+        if(!cursor) src->shared.interrupt();
         port.close();
-        //m.unlock();
+        {
+            std::lock_guard<std::mutex> lk(src->m);
+            if(!cursor) src->closed = true;
+            src->data_signal.notify_all();
+            src->space_signal.notify_all();
+        }
+        src->notifyListeners();
     }
 
     void run()
     {
+        //windows sharing another's packets have nothing to receive
+        if(cursor) {
+            std::unique_lock<std::mutex> lk(src->m);
+            src->data_signal.wait(lk, [this]{return isStopping();});
+            return;
+        }
+
+        ring &r = *src;
         while(true) {
 
-            //find the best memory location to use or create more
-            bool reused_inactive = false;
-            packet<T>* current_packet = nullptr;
-            if(inactive.empty()) {
-                current_packet = new packet<T>;
-            } else {    
-                current_packet = inactive.front();
-                reused_inactive = true;
+            //wait for the slowest reader if the ring is full
+            size_t h = r.head.load();
+            if(r.full(h) && policy == DROP_NONE) {
+                std::unique_lock<std::mutex> lk(r.m);
+                r.writer_waiting = true;
+                r.space_signal.wait(lk, [this, &r, h]{return !r.full(h) || isStopping();});
+                r.writer_waiting = false;
             }
+            if(isStopping()) break;
+
+            //packets are kept in the ring and reused, unless it is full
+            bool full = r.full(h);
+            packet<T>* current_packet = full ? &overflow : r.slots[h & r.mask];
+            if(!current_packet) current_packet = r.slots[h & r.mask] = new packet<T>;
 
             //blocking read from the port
-            bool read_success = port.read(*current_packet);
+            uint64_t seq = 0;
+            bool read_success = r.sharing ? _readShared(*current_packet, seq)
+                                          : port.read(*current_packet);
 
             //and handle return without data
             if(isStopping()) {
@@ -678,21 +1499,40 @@ public:
                 break;
             }
 
-            port.getEnvelope(current_packet->envelope());
-
-            //shared section - updated active, inactive, in_port info
-            {
-                std::lock_guard<std::mutex> lock(m); //releases leaving { }
-                if (reused_inactive) inactive.pop_front();
-                active.push_back(current_packet);
-                in_port.duration += current_packet->duration();
-                in_port.count += current_packet->size();
-                in_port.timestamp = current_packet->timestamp();
+            if(!r.sharing)
+                port.getEnvelope(current_packet->envelope());
+            current_packet->traceRead();
+
+            r.newest_received = current_packet->timestamp();
+            if(full || (policy == DROP_NEWEST && _overLimit(h, *current_packet))) {
+                r.rejected_packets += 1;
+                r.rejected_events += current_packet->size();
+                if(r.sharing) {
+                    r.shared_free = seq + 1;
+                    r.releaseShared();
+                }
+                continue;
+            }
+            if(policy == DROP_DECIMATE && _overLimit(h, *current_packet))
+                _decimate(*current_packet);
+            r.queued_events += current_packet->size();
+
+            //publish the packet, the lock is only needed if a reader sleeps
+            if(r.sharing) r.shared_seq[h & r.mask] = seq;
+            r.head.store(h + 1);
+            if(r.sharing) r.shared_free = seq + 1;
+            if(r.readers_waiting) {
+                std::lock_guard<std::mutex> lk(r.m);
+                r.data_signal.notify_all();
             }
-            signal.notify_one();
+            r.notifyListeners();
         }
-        signal.notify_one();
-
+        {
+            std::lock_guard<std::mutex> lk(r.m);
+            r.closed = true;
+            r.data_signal.notify_all();
+        }
+        r.notifyListeners();
     }
 
     std::string getName()
@@ -708,55 +1548,336 @@ public:
 
 private:
 
+    inline packet<T>& slot(size_t i) const
+    {
+        //packets this reader copied out of shared memory
+        if(!copies.empty() && i - tail() < copies.size())
+            return copies[i - tail()];
+        return *src->slots[i & src->mask];
+    }
+
+    //events of packet i, read in place so that shared memory is not copied
+    inline T* events(size_t i) const
+    {
+        const packet<T> &p = slot(i);
+        return const_cast<T *>(p.begin());
+    }
+
+    //the first packet this window still holds
+    inline std::atomic<size_t>& tail() const
+    {
+        return src->tails[cursor];
+    }
+
+    inline bool _stopped()
+    {
+        return isStopping() || src->closed;
+    }
+
+    //receiving thread: point p at the next packet in shared memory, which
+    //stays held until every reader has passed it (see ring::releaseShared)
+    bool _readShared(packet<T> &p, uint64_t &seq)
+    {
+        p.clear();
+        return src->shared.hold(p, seq);
+    }
+
+    //add packets published by the receiving thread to in_port
+    void _receive()
+    {
+        size_t h = src->head.load();
+        for(; received != h; received++) {
+            if(collector && slot(received).isTraced())
+                collector->add(slot(received).captureTime(), slot(received).traceHops(), yarp::os::Time::now());
+            in_port.duration += slot(received).duration();
+            in_port.count += slot(received).size();
+            in_port.timestamp = slot(received).timestamp();
+        }
+        if(src->sharing) _copyViews();
+    }
+
+    //reader: copy the oldest packets still read in shared memory while this
+    //reader holds more than half of the writer's slots, so that the writer
+    //keeps going when the reader holds packets for longer
+    void _copyViews()
+    {
+        const size_t limit = std::max<size_t>(src->shared.slots() / 2, 1);
+        size_t v = tail().load() + copies.size();
+        if(v == received || src->head.load() - v <= limit) return;
+        do {
+            const packet<T> &view = *src->slots[v & src->mask];
+            copies.emplace_back();
+            packet<T> &copy = copies.back();
+            copy.fillFromMemory((const char *)view.begin(), view.size() * sizeof(T));
+            copy.duration(view.duration());
+            copy.envelope() = yarp::os::Stamp(view.id(), view.timestamp());
+            copy.inheritTrace(view);
+            v++;
+        } while(v != received && src->head.load() - v > limit);
+        src->view_tails[cursor] = v;
+        src->releaseShared();
+    }
+
+    //receiving thread: would queueing p exceed the limits
+    bool _overLimit(size_t h, packet<T> &p)
+    {
+        int s = src->slowest();
+        if(s < 0) return false;
+        size_t t = src->tails[s];
+        if(t == h) return false;
+        return src->queued_events - src->released[s] + p.size() > max_events ||
+               p.timestamp() - src->slots[t & src->mask]->timestamp() > max_age;
+    }
+
+    //receiving thread: keep every second event
+    void _decimate(packet<T> &p)
+    {
+        size_t n = p.size(), kept = (n + 1) / 2;
+        for(size_t i = 1; i < kept; i++)
+            p[i] = p[2 * i];
+        p.resize(kept);
+        src->rejected_events += n - kept;
+    }
+
+    //reader: drop the oldest unread packets until within the limits
+    void _dropOldest(void)
+    {
+        if(policy != DROP_OLDEST) return;
+        while(received - tail().load() > 1) {
+            packet<T> &oldest = slot(tail().load());
+            if(in_port.count <= max_events && in_port.timestamp - oldest.timestamp() <= max_age)
+                break;
+            dropped_packets += 1;
+            dropped_events += oldest.size();
+            _pop();
+        }
+    }
+
+    //sleep only if the condition is not already met
+    template <typename F>
+    void _wait(F condition)
+    {
+        _receive();
+        if(condition() || _stopped()) return;
+        std::unique_lock<std::mutex> lk(src->m);
+        src->readers_waiting++;
+        src->data_signal.wait(lk, [this, &condition]{_receive(); return condition() || _stopped();});
+        src->readers_waiting--;
+    }
+
+    //release the oldest packet, which is reused once all readers release it
+    void _pop(void)
+    {
+        size_t t = tail().load();
+        in_port.duration -= slot(t).duration();
+        in_port.count -= slot(t).size();
+        src->released[cursor] += slot(t).size();
+        if(!copies.empty()) {
+            copies.pop_front();
+        } else if(src->sharing) {
+            src->view_tails[cursor] = t + 1;
+            src->releaseShared();
+        }
+        tail().store(t + 1);
+        if(src->writer_waiting) {
+            std::lock_guard<std::mutex> lk(src->m);
+            src->space_signal.notify_one();
+        }
+    }
+
     void _removeAlreadyRead(void)
     {
-        if(last_packet != active.end()) ++last_packet;
-        while(first_packet != last_packet) {
-            in_port.duration -= (**first_packet).duration();
-            in_port.count -= (**first_packet).size();
-            inactive.push_back(*first_packet);
-            first_packet = active.erase(first_packet);
+        while(tail().load() != last_packet)
+            _pop();
+    }
+
+#if ENABLE_TS
+    //pop packets older than seconds before the newest event and return the
+    //first event in the interval within the oldest remaining packet
+    size_t _firstInTime(double seconds, std::true_type)
+    {
+        size_t newest = received;
+        while(newest != tail().load() && !slot(newest - 1).size()) newest--;
+        if(newest == tail().load()) return 0;
+        const packet<T> &p = slot(newest - 1);
+        const int t_end = p[p.size() - 1].ts;
+        const int limit = secondsToTicks(seconds);
+        auto too_old = [t_end, limit](const T &v) { return deltaTicks(t_end, v.ts) > limit; };
+
+        while(tail().load() != received) {
+            const packet<T> &first = slot(tail().load());
+            if(!first.size() || !too_old(first[first.size() - 1])) break;
+            _pop();
         }
+
+        const packet<T> &first = slot(tail().load());
+        return std::partition_point(first.begin(), first.end(), too_old) - first.begin();
+    }
+
+    size_t _firstInTime(double, std::false_type)
+    {
+        return 0;
     }
+#endif
 
-    void _resetIterators(typename std::list< packet<T>* >::iterator start, typename  std::list< packet<T>* >::iterator end)
+    //offset is the first event of the window in the first packet
+    void _resetIterators(size_t start, size_t end, size_t offset = 0)
     {
-        if(active.empty()) {
-            first_packet = active.begin();
-            last_packet = active.begin();
+        first_packet = start;
+        last_packet = end;
+        trimmed = {0, 0.0, 0.0};
+        if(start == end) {
             _begin = iterator();
             _end = iterator();
         } else {
-            first_packet = start;
-            last_packet = std::prev(end); //we need to drop it back one so it is inclusive in the data
-            _begin.setAsStart(first_packet, last_packet);
-            _end.setAsEnd(last_packet);
+            //the iterators are inclusive of the last packet
+            newest_read = slot(end - 1).timestamp();
+            _begin.setAsStart(this, start, end - 1, offset);
+            _end.setAsEnd(this, end - 1);
         }
     }
 
     //input port
     yarp::os::Port port;
 
-    //data storage
-    std::list< packet<T>* > active;
-    std::list< packet<T>* > inactive;
+    //data storage. A ring with a single writer, the receiving thread, which
+    //fills slots from head. Each reader holds the packets from its tail to
+    //head, and a slot is reused once the slowest reader has released it.
+    struct ring
+    {
+        static constexpr unsigned int max_readers = 16;
+
+        std::vector< packet<T>* > slots;
+        size_t mask{0};
+        std::atomic<size_t> head{0};
+        //unused readers have a tail of SIZE_MAX
+        std::atomic<size_t> tails[max_readers];
+        std::atomic<size_t> released[max_readers];
+        std::atomic<size_t> queued_events{0};
+        std::atomic<size_t> rejected_packets{0};
+        std::atomic<size_t> rejected_events{0};
+        std::atomic<double> newest_received{0.0};
+        std::atomic<bool> closed{false};
+
+        //only used to sleep when there is nothing to do
+        std::mutex m;
+        std::condition_variable data_signal;
+        std::condition_variable space_signal;
+        std::atomic<int> readers_waiting{0};
+        std::atomic<bool> writer_waiting{false};
+        //signals of the readers that also wait elsewhere (window::notify)
+        std::shared_ptr<dataSignal> listeners[max_readers];
+        std::atomic<bool> listening{false};
+
+        //shared memory input (window::openShared). Packets are views of its
+        //slots, and each reader reads packets from its view tail in place.
+        //Older packets that it still holds are copies.
+        shmemReader<T> shared;
+        std::atomic<bool> sharing{false};
+        std::vector< std::atomic<uint64_t> > shared_seq;
+        std::atomic<size_t> view_tails[max_readers];
+        //slots before shared_free are not needed once every packet is passed
+        std::atomic<uint64_t> shared_free{0};
+
+        ring(unsigned int max_packets)
+        {
+            size_t n = 2;
+            while(n < max_packets) n <<= 1;
+            slots.resize(n, nullptr);
+            shared_seq = std::vector< std::atomic<uint64_t> >(n);
+            mask = n - 1;
+            for(unsigned int i = 0; i < max_readers; i++) {
+                tails[i] = SIZE_MAX;
+                view_tails[i] = SIZE_MAX;
+                released[i] = 0;
+            }
+            tails[0] = 0;
+            view_tails[0] = 0;
+        }
+
+        ~ring()
+        {
+            for(auto p : slots)
+                delete p;
+        }
+
+        //the reader furthest behind, -1 if there are none
+        int slowest() const
+        {
+            int s = -1;
+            size_t t = SIZE_MAX;
+            for(unsigned int i = 0; i < max_readers; i++) {
+                size_t c = tails[i];
+                if(c < t) { t = c; s = i; }
+            }
+            return s;
+        }
+
+        bool full(size_t h) const
+        {
+            int s = slowest();
+            return s >= 0 && h - tails[s] > mask;
+        }
+
+        //give the writer back the slots that no reader reads in place
+        void releaseShared()
+        {
+            uint64_t free = shared_free.load();
+            size_t h = head.load();
+            size_t t = SIZE_MAX;
+            for(auto &v : view_tails)
+                t = std::min(t, v.load());
+            if(t >= h) {
+                shared.release(free);
+                return;
+            }
+            uint64_t seq = shared_seq[t & mask];
+            //the entry was reused if the ring went round since reading t
+            if(head.load() - t > mask) return;
+            shared.release(seq);
+        }
+
+        void notifyListeners()
+        {
+            if(!listening) return;
+            for(auto &l : listeners)
+                if(std::shared_ptr<dataSignal> s = std::atomic_load(&l))
+                    s->notify();
+        }
+    };
+
+    std::shared_ptr<ring> src;
+    unsigned int cursor{0};
+    //copies of the packets [tail, view tail) of a shared memory input
+    mutable std::deque< packet<T> > copies;
+    //packets [tail, received) are counted in in_port
+    size_t received{0};
+    //incoming packet when the ring is full
+    packet<T> overflow;
+
+    //drop policy and latency statistics
+    dropPolicy policy{DROP_NONE};
+    double max_age{DBL_MAX};
+    unsigned int max_events{UINT_MAX};
+    std::atomic<size_t> dropped_packets{0};
+    std::atomic<size_t> dropped_events{0};
+    std::atomic<double> newest_read{0.0};
+    traceCollector *collector{nullptr};
 
     //in_port is all data that has been read
     info in_port{0};
     //in_window is data that is actively asked to be interated through
     info in_window{0};
+    //trimmed is data in the first packet of the window that is skipped
+    info trimmed{0};
 
-    //packet iterators point to packets be "in_window"
-    typename std::list< packet<T>* >::iterator last_packet;
-    typename std::list< packet<T>* >::iterator first_packet;
+    //packet indices of the data "in_window" [first_packet, last_packet)
+    size_t first_packet{0};
+    size_t last_packet{0};
     //iterators point to individual events "in_window"
     iterator _begin;
     iterator _end;
 
-    //thread synchronisation
-    std::mutex m;
-    std::condition_variable signal;
-
 };
 
 template <typename T>
@@ -766,62 +1887,564 @@ public:
 struct iterator;
 
 private:
-    std::list< ev::packet<T> > data;
-    iterator _begin;//{{nullptr, nullptr, -1, -1.0, nullptr}};
-    iterator _end;//{{nullptr, nullptr, -1, -1.0, nullptr}};
+    //the packet index and event storage. text logs are decoded into owned
+    //storage, binary recordings are used in-place from the memory mapping.
+    //when streaming, a decoder thread fills a ring of index records and a
+    //fixed size arena of events that is released as reading progresses.
+#if ENABLE_TS
+    static constexpr bool event_stamps = true;
+#else
+    static constexpr bool event_stamps = false;
+#endif
+
+    std::vector<packetIndex> owned_index;
+    std::vector<T> owned_events;
+    //logs parsed in parallel keep the events where each thread decoded them,
+    //with the first event of each packet in packet_events
+    std::vector< std::vector<T> > owned_chunks;
+    std::vector<T*> packet_events;
+    mappedFile mapping;
+    const packetIndex *index{nullptr};
+    size_t index_mask{SIZE_MAX};
+    char *base{nullptr};
+    std::atomic<size_t> n_packets{0};
+
+    iterator _begin;
+    iterator _end;
     double time_sync_offset{0.0};
-    int event_count{0};
+    size_t event_count{0};
+    double start_time{0.0};
+    double final_time{0.0};
+
+    //streaming state. n_packets is the decoder head, tail is the oldest
+    //packet still in use by the reader.
+    bool streaming{false};
+    std::string stream_path;
+    double stream_seconds{DBL_MAX};
+    std::vector<char> arena;
+    std::thread decoder;
+    std::mutex stream_m;
+    std::condition_variable stream_signal;
+    size_t tail{0};
+    double released_time{-DBL_MAX};
+    size_t write_pos{0};
+    bool stream_stop{false};
+    bool stream_finished{false};
+    bool stream_full{false};
+    bool truncation_warned{false};
+
+    inline const packetIndex& record(size_t i) const
+    {
+        return index[i & index_mask];
+    }
+
+    inline T* packetBegin(size_t i) const
+    {
+        if(!packet_events.empty()) return packet_events[i];
+        return (T *)(base + record(i).offset);
+    }
+
+    inline T* packetEnd(size_t i) const
+    {
+        return packetBegin(i) + record(i).count;
+    }
+
+    //check packet i exists. When streaming wait for the decoder to reach it,
+    //unless the decoder is finished or blocked by a full look-ahead buffer.
+    bool available(size_t i)
+    {
+        if(!streaming) return i < n_packets;
+        std::unique_lock<std::mutex> lk(stream_m);
+        stream_signal.wait(lk, [&]{return i < n_packets || stream_finished || stream_full;});
+        if(i >= n_packets && !stream_finished && !truncation_warned) {
+            yWarning() << "[offlineLoader] the read window is larger than the look-ahead buffer, it is truncated";
+            truncation_warned = true;
+        }
+        return i < n_packets;
+    }
+
+    //allow the decoder to overwrite all packets before i
+    void release(size_t i)
+    {
+        if(!streaming) return;
+        std::unique_lock<std::mutex> lk(stream_m);
+        i = std::min<size_t>(i, n_packets);
+        if(i <= tail) return;
+        released_time = std::max(released_time, record(i - 1).timestamp);
+        tail = i;
+        stream_full = false;
+        stream_signal.notify_all();
+    }
+
+    //find space for bytes in the arena without overwriting packets from the
+    //tail onwards. Packets are never split across the end of the arena.
+    bool reserve(size_t bytes, size_t &offset) const
+    {
+        if(n_packets - tail > index_mask) return false;
+
+        //empty packets do not occupy the arena
+        size_t oldest = tail;
+        while(oldest < n_packets && record(oldest).count == 0) oldest++;
+        if(oldest == n_packets) {
+            offset = 0;
+            return true;
+        }
+
+        size_t tail_off = record(oldest).offset;
+        if(write_pos > tail_off) {
+            if(arena.size() - write_pos >= bytes) {
+                offset = write_pos;
+                return true;
+            }
+            if(bytes <= tail_off) {
+                offset = 0;
+                return true;
+            }
+        } else if(write_pos < tail_off && tail_off - write_pos >= bytes) {
+            offset = write_pos;
+            return true;
+        }
+        return false;
+    }
+
+    void decode()
+    {
+        std::ifstream reader(stream_path);
+        std::string data_line;
+        packetIndex *ring = owned_index.data();
+        const size_t max_bytes = arena.size() - arena.size() % sizeof(T);
+        bool truncated = false;
+        std::vector<T> whole;
+
+        while(getline(reader, data_line))
+        {
+            yarp::os::Bottle b(data_line);
+            lineData line = lineEvents(b);
+            size_t bytes = line.count * sizeof(T);
+            if(bytes > max_bytes) {
+                if(!truncated)
+                    yWarning() << "[offlineLoader] packet larger than the look-ahead buffer, truncating";
+                truncated = true;
+                bytes = max_bytes;
+            }
+
+            size_t offset = 0, head = 0;
+            {
+                std::unique_lock<std::mutex> lk(stream_m);
+                while(!stream_stop && !reserve(bytes, offset)) {
+                    stream_full = true;
+                    stream_signal.notify_all();
+                    stream_signal.wait(lk);
+                }
+                stream_full = false;
+                if(stream_stop) break;
+                head = n_packets;
+            }
+
+            //the reserved space and record are not visible to the reader
+            //until the head is incremented. A truncated compressed packet
+            //is decoded whole first.
+            T *events = (T *)(arena.data() + offset);
+            bool valid = true;
+            if(bytes == line.count * sizeof(T)) {
+                valid = decodeLine(line, events);
+            } else if(!line.compressed) {
+                std::memcpy((char *)events, line.blob.data(), bytes);
+            } else {
+                whole.resize(line.count);
+                valid = decodeLine(line, whole.data());
+                std::memcpy((char *)events, (const char *)whole.data(), bytes);
+            }
+            if(!valid) bytes = 0;
+            ring[head & index_mask] = {b.get(1).asFloat64(),
+                                       b.get(3).asInt32()*0.000001,
+                                       b.get(0).asInt32(),
+                                       (uint32_t)(bytes / sizeof(T)),
+                                       offset};
+
+            std::unique_lock<std::mutex> lk(stream_m);
+            if(head == 0) start_time = ring[0].timestamp;
+            write_pos = offset + bytes;
+            event_count += bytes / sizeof(T);
+            n_packets++;
+            stream_signal.notify_all();
+            if(ring[head & index_mask].timestamp - start_time > stream_seconds) break;
+        }
+
+        std::unique_lock<std::mutex> lk(stream_m);
+        stream_finished = true;
+        stream_signal.notify_all();
+    }
+
+    void startStream()
+    {
+        stopStream();
+        n_packets = 0;
+        tail = 0;
+        released_time = -DBL_MAX;
+        write_pos = 0;
+        event_count = 0;
+        stream_stop = false;
+        stream_finished = false;
+        stream_full = false;
+        decoder = std::thread([this]{decode();});
+    }
+
+    void stopStream()
+    {
+        if(!decoder.joinable()) return;
+        {
+            std::unique_lock<std::mutex> lk(stream_m);
+            stream_stop = true;
+            stream_signal.notify_all();
+        }
+        decoder.join();
+    }
+
+    //when streaming, move forward to the first packet at or after t, releasing
+    //packets as they are passed. Only seeking to a packet that was already
+    //released restarts the decoder from the start of the file.
+    size_t streamTo(double t)
+    {
+        size_t i = 0;
+        bool behind = false;
+        {
+            std::unique_lock<std::mutex> lk(stream_m);
+            i = tail;
+            behind = released_time >= t;
+        }
+        if(i > 0 && behind) {
+            startStream();
+            i = 0;
+        }
+        while(available(i) && record(i).timestamp < t)
+            release(++i);
+        return i;
+    }
+
+    //the timestamp of the final packet read from the end of a text log
+    static double lastTimestamp(const std::string &path)
+    {
+        std::ifstream reader(path, std::ios::binary | std::ios::ate);
+        std::streamoff end = reader.tellg();
+        if(end <= 0) return 0.0;
+        std::string tail_data;
+        for(std::streamoff chunk = 4096; reader && chunk < 2 * end + 4096; chunk *= 2) {
+            std::streamoff start = std::max<std::streamoff>(0, end - chunk);
+            tail_data.resize(end - start);
+            reader.seekg(start);
+            reader.read(&tail_data[0], end - start);
+            while(!tail_data.empty() && (tail_data.back() == '\n' || tail_data.back() == '\r'))
+                tail_data.pop_back();
+            size_t line = tail_data.rfind('\n');
+            if(line != std::string::npos || start == 0) {
+                //only the packet id and timestamp are needed
+                std::stringstream ss(tail_data.substr(line == std::string::npos ? 0 : line + 1));
+                int id; double ts = 0.0;
+                ss >> id >> ts;
+                return ts;
+            }
+        }
+        return 0.0;
+    }
+
+    //first packet with a timestamp at or after t (packet timestamps are
+    //monotonic, so the index can be binary searched)
+    size_t findPacket(double t) const
+    {
+        return std::lower_bound(index, index + n_packets, t,
+            [](const packetIndex &p, double t){return p.timestamp < t;}) - index;
+    }
+
+    //first event in packet i at or after time t. The final event of a packet
+    //is assumed to occur at the packet timestamp.
+    T* findEvent(size_t i, double t, std::true_type) const
+    {
+        T *first = packetBegin(i), *last = packetEnd(i);
+        if(first == last) return first;
+        const unsigned int final_ts = (last-1)->ts;
+        const double packet_t = record(i).timestamp;
+        return std::partition_point(first, last, [&](const T &v){
+            return packet_t - deltaS(final_ts, v.ts) < t;});
+    }
+
+    //without event timestamps the packet is the finest resolution
+    T* findEvent(size_t i, double t, std::false_type) const
+    {
+        return packetBegin(i);
+    }
+
+    T* findEvent(size_t i, double t) const
+    {
+        return findEvent(i, t, std::integral_constant<bool,
+            event_stamps && std::is_base_of<timeStamp, T>::value>());
+    }
 
-    bool setIterators(typename std::list< packet<T> >::iterator same_packet)
+    bool setIterators(size_t same_packet)
     {
-        if(data.size() == 0) return false;
         bool ret = true;
 
         //if same_packet is the end of data set both pointers to point to the final packet end
         //else set them to the same packet start
-        if(same_packet == data.end()) 
+        if(!available(same_packet))
         {
-            same_packet = std::prev(data.end());
-            _begin.m_ptr = same_packet->end();
+            if(n_packets == 0) return false;
+            same_packet = n_packets - 1;
+            _begin.bind(this, same_packet, same_packet);
+            _begin.m_ptr = _begin.p_end;
             ret = false;
         } else {
-            _begin.m_ptr = same_packet->begin();
+            _begin.bind(this, same_packet, same_packet);
         }
-        _begin.packet_it = same_packet;
-        _begin.final = same_packet;
-        _begin._id = same_packet->id();
-        _begin._timestamp = same_packet->timestamp();
         _end = _begin;
         return ret;
     }
 
-    bool setIterators(typename std::list< packet<T> >::iterator first_packet, typename std::list< packet<T> >::iterator last_packet)
+    bool setIterators(size_t first_packet, size_t last_packet)
     {
         //if the first packet is finished the data invalidate the pointers.
-        if(first_packet == data.end()) 
+        if(first_packet >= n_packets)
         {
             return setIterators(first_packet);
         }
 
         //if the last packet
-        if(last_packet == data.end()) last_packet = std::prev(last_packet);
-
-        _begin.packet_it = first_packet;
-        _begin.final = last_packet;
-        _begin._id = first_packet->id();
-        _begin._timestamp = first_packet->timestamp();
-        _begin.m_ptr = first_packet->begin();
-
-        _end.packet_it = last_packet;
-        _end.final = last_packet;
-        _end._id = last_packet->id();
-        _end._timestamp = last_packet->timestamp();
-        _end.m_ptr = last_packet->end();
+        if(last_packet >= n_packets) last_packet = n_packets - 1;
+
+        _begin.bind(this, first_packet, last_packet);
+        _end.bind(this, last_packet, last_packet);
+        _end.m_ptr = _end.p_end;
+        return true;
+    }
+
+    void reset()
+    {
+        stopStream();
+        streaming = false;
+        arena = std::vector<char>();
+        mapping.close();
+        owned_index.clear();
+        owned_events.clear();
+        owned_chunks.clear();
+        packet_events.clear();
+        index = nullptr;
+        index_mask = SIZE_MAX;
+        base = nullptr;
+        n_packets = 0;
+        event_count = 0;
+        truncation_warned = false;
+        start_time = final_time = 0.0;
+        _begin = iterator();
+        _end = iterator();
+    }
+
+    //the events of a yarpdatadumper line, raw or compressed (see
+    //ev::compressor)
+    struct lineData {
+        std::string blob;
+        bool compressed;
+        uint32_t count;
+    };
+
+    static lineData lineEvents(const yarp::os::Bottle &b)
+    {
+        lineData line{b.get(4).asString(), false, 0};
+        line.compressed = compressor<T>::available && b.get(2).asString() == compressor<T>::tag();
+        if(line.compressed)
+            line.count = compressor<T>::count((const uint8_t *)line.blob.data(), line.blob.size());
+        else
+            line.count = line.blob.size() / sizeof(T);
+        return line;
+    }
+
+    //decode the line.count events of line. Returns false if they are invalid
+    static bool decodeLine(const lineData &line, T *events)
+    {
+        if(!line.count) return true;
+        if(line.compressed)
+            return compressor<T>::decode((const uint8_t *)line.blob.data(), line.blob.size(), events, line.count);
+        std::memcpy((char *)events, line.blob.data(), line.count * sizeof(T));
+        return true;
+    }
+
+    //decode a single yarpdatadumper line, appending to idx and events
+    static void parseLine(const std::string &data_line, std::vector<packetIndex> &idx, std::vector<T> &events)
+    {
+        yarp::os::Bottle b(data_line);
+        lineData line = lineEvents(b);
+
+        size_t n = events.size();
+        events.resize(n + line.count);
+        if(!decodeLine(line, events.data() + n)) {
+            events.resize(n);
+            line.count = 0;
+        }
+        idx.push_back({b.get(1).asFloat64(),
+                       b.get(3).asInt32()*0.000001,
+                       b.get(0).asInt32(),
+                       line.count,
+                       n * sizeof(T)});
+    }
+
+    bool loadText(const std::string &path, double seconds, unsigned int threads)
+    {
+        std::ifstream reader;
+        reader.open(path.c_str(), std::ios::binary | std::ios::ate);
+        if(!reader.is_open())
+            return false;
+        std::streamoff file_size = reader.tellg();
+        reader.seekg(0);
+
+        //a limited length is read sequentially, as most of the file is unused
+        if(threads > 1 && seconds == DBL_MAX && file_size > (1 << 20))
+            return loadTextParallel(reader, path, file_size, threads);
+
+        std::string data_line;
+        while(getline(reader, data_line))
+        {
+            parseLine(data_line, owned_index, owned_events);
+            if(owned_index.back().timestamp - owned_index.front().timestamp > seconds) break;
+        }
+
+        for(auto &p : owned_index) event_count += p.count;
+        index = owned_index.data();
+        base = (char *)owned_events.data();
+        n_packets = owned_index.size();
+        return true;
+    }
+
+    //split the file into chunks at line boundaries, parse each chunk on its
+    //own thread and join the chunk indices back together in order. The
+    //events are left in each chunk's buffer rather than copied.
+    bool loadTextParallel(std::ifstream &reader, const std::string &path, std::streamoff file_size, unsigned int threads)
+    {
+        std::vector<std::streamoff> splits = {0};
+        std::string data_line;
+        for(unsigned int k = 1; k < threads; k++) {
+            //step back one byte so a chunk starting exactly on a line is kept
+            std::streamoff target = file_size * k / threads - 1;
+            if(target < splits.back()) continue;
+            reader.seekg(target);
+            getline(reader, data_line);
+            if(!reader) break;
+            splits.push_back(reader.tellg());
+        }
+        splits.push_back(file_size);
+        reader.clear();
+
+        const size_t chunks = splits.size() - 1;
+        std::vector< std::vector<packetIndex> > chunk_index(chunks);
+        std::vector< std::vector<T> > chunk_events(chunks);
+        std::vector<std::thread> workers;
+        for(size_t c = 0; c < chunks; c++) {
+            workers.emplace_back([&, c] {
+                std::ifstream chunk_reader(path, std::ios::binary);
+                chunk_reader.seekg(splits[c]);
+                std::string line;
+                std::streamoff position = splits[c];
+                while(position < splits[c + 1] && getline(chunk_reader, line)) {
+                    position += line.size() + 1;
+                    parseLine(line, chunk_index[c], chunk_events[c]);
+                }
+            });
+        }
+        for(auto &w : workers) w.join();
+
+        size_t total_packets = 0, total_events = 0;
+        for(size_t c = 0; c < chunks; c++) {
+            total_packets += chunk_index[c].size();
+            total_events += chunk_events[c].size();
+        }
+        owned_index.reserve(total_packets);
+        packet_events.reserve(total_packets);
+        owned_chunks = std::move(chunk_events);
+        for(size_t c = 0; c < chunks; c++) {
+            T *chunk_base = owned_chunks[c].data();
+            for(auto &p : chunk_index[c]) {
+                packet_events.push_back(chunk_base + p.offset / sizeof(T));
+                owned_index.push_back(p);
+            }
+            std::vector<packetIndex>().swap(chunk_index[c]);
+        }
+
+        event_count = total_events;
+        index = owned_index.data();
+        n_packets = owned_index.size();
+        return true;
+    }
+
+    bool loadBinary(const std::string &path, double seconds)
+    {
+        if(!mapping.open(path))
+            return false;
+
+        if(mapping.size() < sizeof(recordingHeader) + sizeof(recordingTrailer)) {
+            yError() << "[offlineLoader] truncated recording" << path;
+            mapping.close();
+            return false;
+        }
+
+        const recordingHeader &header = *(const recordingHeader *)mapping.data();
+        if(header.event_size != sizeof(T) || std::strncmp(header.tag, T::tag.c_str(), sizeof(header.tag))) {
+            yError() << "[offlineLoader] recording does not contain" << T::tag << "events";
+            mapping.close();
+            return false;
+        }
+
+        //the index fills the space between the events and the trailer
+        const recordingTrailer &trailer = *(const recordingTrailer *)(mapping.data() + mapping.size() - sizeof(recordingTrailer));
+        const uint64_t index_end = mapping.size() - sizeof(recordingTrailer);
+        if(std::memcmp(trailer.magic, recording_magic, sizeof(recording_magic)) ||
+           trailer.index_offset < sizeof(recordingHeader) || trailer.index_offset > index_end ||
+           trailer.packets != (index_end - trailer.index_offset) / sizeof(packetIndex) ||
+           (index_end - trailer.index_offset) % sizeof(packetIndex)) {
+            yError() << "[offlineLoader] recording has no valid index (was it closed correctly?)" << path;
+            mapping.close();
+            return false;
+        }
+
+        base = mapping.data();
+        index = (const packetIndex *)(base + trailer.index_offset);
+        n_packets = trailer.packets;
+        event_count = 0;
+
+        //every packet must lie within the events, in time order
+        for(size_t i = 0; i < n_packets; i++) {
+            const packetIndex &p = index[i];
+            if(p.offset < sizeof(recordingHeader) || p.offset > trailer.index_offset ||
+               p.count > (trailer.index_offset - p.offset) / sizeof(T) ||
+               (i && p.timestamp < index[i - 1].timestamp)) {
+                yError() << "[offlineLoader] recording index is corrupt at packet" << i << path;
+                mapping.close();
+                return false;
+            }
+            event_count += p.count;
+        }
+
+        //limit the dataset length using the index instead of reading it
+        if(n_packets && seconds < DBL_MAX) {
+            double t_max = index[0].timestamp + seconds;
+            const packetIndex *limit = std::upper_bound(index, index + n_packets, t_max,
+                [](double t, const packetIndex &p){return t < p.timestamp;});
+            n_packets = std::min<size_t>(limit - index + 1, n_packets);
+            event_count = 0;
+            for(size_t i = 0; i < n_packets; i++) event_count += index[i].count;
+        }
+
         return true;
     }
 
 public:
 
+    offlineLoader() = default;
+    offlineLoader(const offlineLoader&) = delete;
+    offlineLoader& operator=(const offlineLoader&) = delete;
+
+    ~offlineLoader()
+    {
+        stopStream();
+    }
+
     struct iterator
     {
         using iterator_category = std::forward_iterator_tag;
@@ -834,26 +2457,20 @@ public:
         inline double packetID() {return _id;}
 
         T& operator*() const { return *m_ptr; }
-        T* operator->() { return &(*m_ptr); }
+        T* operator->() { return m_ptr; }
         iterator& operator++()
         {
             m_ptr++;
-            if(m_ptr == packet_it->end() && packet_it != final) {
-                m_ptr = (++packet_it)->begin();
-                _timestamp = packet_it->timestamp();
-                _id = packet_it->id();
-            }
+            if(m_ptr == p_end && packet != final)
+                nextPacket();
             return *this;
         }
 
         iterator& operator++(int k)
         {
             m_ptr++;
-            if(m_ptr == packet_it->end() && packet_it != final) {
-                m_ptr = (++packet_it)->begin();
-                _timestamp = packet_it->timestamp();
-                _id = packet_it->id();
-            }
+            if(m_ptr == p_end && packet != final)
+                nextPacket();
             return *this;
         }
 
@@ -864,126 +2481,268 @@ public:
         private:
             int _id{-1};
             double _timestamp{0.0};
-            typename packet<T>::iterator m_ptr{};
-            typename std::list< packet<T> >::iterator packet_it;
-            typename std::list< packet<T> >::iterator final;
+            T* m_ptr{nullptr};
+            T* p_end{nullptr};
+            size_t packet{0};
+            size_t final{0};
+            const offlineLoader *loader{nullptr};
+
+            void bind(const offlineLoader *l, size_t first, size_t last)
+            {
+                loader = l;
+                packet = first;
+                final = last;
+                m_ptr = loader->packetBegin(packet);
+                p_end = loader->packetEnd(packet);
+                _timestamp = loader->record(packet).timestamp;
+                _id = loader->record(packet).id;
+                if(m_ptr == p_end && packet != final)
+                    nextPacket();
+            }
+
+            void nextPacket()
+            {
+                //skip any empty packets
+                do {
+                    packet++;
+                    m_ptr = loader->packetBegin(packet);
+                    p_end = loader->packetEnd(packet);
+                } while(m_ptr == p_end && packet != final);
+                _timestamp = loader->record(packet).timestamp;
+                _id = loader->record(packet).id;
+            }
     };
 
-    bool load(std::string path, double seconds = DBL_MAX)
+    /// \brief load a dataset. yarpdatadumper logs are decoded into memory
+    /// using threads (0 = all cores), binary recordings (see
+    /// ev::offlineWriter) are memory-mapped and the events are used in-place
+    bool load(std::string path, double seconds = DBL_MAX, unsigned int threads = 1)
     {
         if(seconds < 0.0) seconds = DBL_MAX;
-        data.clear();
+        reset();
+
+        bool loaded = isBinaryRecording(path) ? loadBinary(path, seconds)
+                                              : loadText(path, seconds, threads ? threads : std::thread::hardware_concurrency());
+        if(!loaded) return false;
+        if(n_packets) {
+            start_time = index[0].timestamp;
+            final_time = index[n_packets - 1].timestamp;
+        }
 
-        std::ifstream reader;
-        reader.open(path.c_str());
-        if(!reader.is_open())
-            return false;
+        //set both pointing to first event
+        setIterators(0);
+        //time_sync_offset = -index[0].timestamp;
 
-        std::string data_line;
-        while(getline(reader, data_line)) 
-        {
-            yarp::os::Bottle b(data_line);
-            
-            data.emplace_back(); ev::packet<T> &p = data.back();
-            p.envelope() = {b.get(0).asInt32(), b.get(1).asFloat64()};
-            p.duration(b.get(3).asInt32()*0.000001);
-            p.fillFromMemory(b.get(4).asString().data(), b.get(4).asString().size());
-            event_count += p.size();
+        return true;
+    }
 
-            if(p.timestamp() - data.begin()->timestamp() > seconds) break;
+    /// \brief open a dataset for reading without holding it all in memory. A
+    /// yarpdatadumper log is decoded by a background thread into a look-ahead
+    /// buffer of budget_mb, which is released as the read position passes it.
+    /// Binary recordings are memory-mapped with sequential read-ahead. Reads
+    /// do not return windows larger than the look-ahead buffer.
+    bool stream(std::string path, double budget_mb = 64.0, double seconds = DBL_MAX)
+    {
+        if(seconds < 0.0) seconds = DBL_MAX;
+        if(isBinaryRecording(path)) {
+            if(!load(path, seconds)) return false;
+            if(n_packets)
+                mapping.adviseSequential(record(0).offset, mapping.size() - record(0).offset);
+            return true;
         }
 
-        //set both pointing to first event
-        setIterators(data.begin());
-        //time_sync_offset = -data.begin()->timestamp();
+        reset();
+        if(!std::ifstream(path).is_open())
+            return false;
 
+        //index records for packets of ~1 kB on average
+        size_t records = 1024;
+        while(records < (1 << 20) && records * 1024 < budget_mb * 1e6) records <<= 1;
+        owned_index.resize(records);
+        index = owned_index.data();
+        index_mask = records - 1;
+        arena.resize(std::max<size_t>(budget_mb * 1e6, sizeof(T)));
+        base = arena.data();
+        stream_path = path;
+        stream_seconds = seconds;
+        streaming = true;
+        startStream();
+
+        if(!available(0)) {
+            reset();
+            return false;
+        }
+        final_time = std::min(lastTimestamp(path), start_time + seconds);
+
+        setIterators(0);
         return true;
     }
 
+    /// \brief save the loaded data as a binary recording. A streamed text
+    /// log is read to its end.
+    bool save(std::string path)
+    {
+        offlineWriter<T> writer;
+        if(!writer.open(path)) return false;
+        if(streaming) streamTo(-DBL_MAX);
+        for(size_t i = 0; available(i); i++) {
+            writer.write(packetBegin(i), record(i).count, record(i).timestamp, record(i).duration, record(i).id);
+            release(i + 1);
+        }
+        return writer.close();
+    }
+
     void synchroniseRealtimeRead(double now)
     {
-        time_sync_offset = now - data.begin()->timestamp();
+        time_sync_offset = now - getStartTime();
     }
 
     bool incrementReadTill(double timestamp)
     {
-        if(data.size() == 0) return false;
+        if(n_packets == 0) return false;
         timestamp -= time_sync_offset;
 
         //firstly set both iterators to point to the next packet if needed
         if(_end != _begin) {
-            std::advance(_end.packet_it, 1);
-            if(!setIterators(_end.packet_it))
+            release(_end.packet + 1);
+            if(!setIterators(_end.packet + 1))
                 return false;
         }
 
         //if timestamp is greater than the next packet increment the _end packet
-        while(std::next(_end.packet_it) != data.end() && std::next(_end.packet_it)->timestamp() < timestamp)
-            std::advance(_end.packet_it, 1);
+        size_t last = _end.packet;
+        while(available(last + 1) && record(last + 1).timestamp < timestamp)
+            last++;
 
         //if the current packet is under timestamp, set the iterators to deliver this data
-        if(_begin.packet_it->timestamp() < timestamp)
-            setIterators(_begin.packet_it, _end.packet_it);
+        if(record(_begin.packet).timestamp < timestamp)
+            setIterators(_begin.packet, last);
+        else
+            _end.packet = last;
 
         return true;
     }
 
     bool windowedReadTill(double timestamp, double duration)
     {
-        if(data.size() == 0) return false;
+        if(n_packets == 0) return false;
         timestamp -= time_sync_offset;
 
         //if timestamp is greater than the next packet increment the _end packet
-        while(std::next(_end.packet_it) != data.end() && std::next(_end.packet_it)->timestamp() < timestamp)
-            std::advance(_end.packet_it, 1);
+        size_t last = _end.packet;
+        while(available(last + 1) && record(last + 1).timestamp < timestamp)
+            last++;
 
-        while(timestamp - _begin.packet_it->timestamp() > duration) {
-            if(std::next(_begin.packet_it) == data.end()) {
+        size_t first = _begin.packet;
+        while(timestamp - record(first).timestamp > duration) {
+            if(!available(first + 1)) {
                 return false; //finish the dataset
             } else {
-                std::advance(_begin.packet_it, 1); //increment the oldest packet
+                first++; //increment the oldest packet
             }
-            if(_begin.packet_it == _end.packet_it) break; //return atleast a single packet
+            if(first == last) break; //return atleast a single packet
         }
 
-        setIterators(_begin.packet_it, _end.packet_it);
+        setIterators(first, last);
+        release(first);
 
         return true;
 
     }
 
+    /// \brief move the read position to time t (in the same time-base as
+    /// incrementReadTill) in O(log n) packets. Following reads continue from
+    /// the first packet at or after t. Seeking backwards is allowed. When
+    /// streaming, seeking is linear in the packets decoded.
+    bool seek(double t)
+    {
+        if(n_packets == 0) return false;
+        t -= time_sync_offset;
+        return setIterators(streaming ? streamTo(t) : findPacket(t));
+    }
+
+    /// \brief set the iterators to the data between [t0, t1) (in the same
+    /// time-base as incrementReadTill) in O(log n) packets. With ENABLE_TS the
+    /// boundary packets are searched to the exact event, otherwise whole
+    /// packets with timestamps in [t0, t1) are returned. When streaming the
+    /// range is truncated to the look-ahead buffer.
+    info range(double t0, double t1)
+    {
+        if(n_packets == 0 || t1 <= t0) return {0, 0.0, 0.0};
+        t0 -= time_sync_offset;
+        t1 -= time_sync_offset;
+
+        size_t first, last;
+        if(streaming) {
+            first = last = streamTo(t0);
+            while(available(last) && record(last).timestamp < t1) last++;
+        } else {
+            first = findPacket(t0);
+            last = findPacket(t1);
+        }
+
+        //the packet crossing t1 holds events before t1 when timestamps are
+        //individually resolved
+        T *last_ptr = nullptr;
+        if(available(last)) {
+            last_ptr = findEvent(last, t1);
+            if(last_ptr == packetBegin(last)) last_ptr = nullptr;
+        }
+        if(last_ptr == nullptr) {
+            if(last == first) {
+                setIterators(first);
+                return {0, 0.0, 0.0};
+            }
+            last--;
+            last_ptr = packetEnd(last);
+        }
+
+        T *first_ptr = findEvent(first, t0);
+        setIterators(first, last);
+        if(first_ptr != packetEnd(first)) _begin.m_ptr = first_ptr;
+        _end.m_ptr = last_ptr;
+
+        info stats{0, 0.0, record(last).timestamp};
+        for(size_t i = first; i <= last; i++) {
+            T *b = i == first ? first_ptr : packetBegin(i);
+            T *e = i == last ? last_ptr : packetEnd(i);
+            stats.count += e - b;
+            stats.duration += record(i).duration;
+        }
+
+        return stats;
+    }
+
     iterator begin() { return _begin; }
     iterator end()   { return _end; }
 
     std::string getinfo() {
         std::stringstream ss;
-        if(data.size() == 0)
+        if(n_packets == 0)
             return "no events loaded";
-        
-        ss << data.size() << " packets loaded with " << event_count << " total events. "
-           << "Timestamps range from " << std::fixed << std::setprecision(3) << data.begin()->timestamp() << " to " << std::prev(data.end())->timestamp();
-        
+
+        if(streaming)
+            ss << "streaming with a " << arena.size() / 1e6 << " MB look-ahead. ";
+        else
+            ss << n_packets << " packets loaded with " << event_count << " total events. ";
+        ss << "Timestamps range from " << std::fixed << std::setprecision(3) << start_time << " to " << final_time;
+        if(mapping.isOpen())
+            ss << " (memory-mapped)";
+
         return ss.str();
     }
 
-    double getLength() 
+    double getLength()
     {
-        if(data.size())
-            return std::prev(data.end())->timestamp() - data.begin()->timestamp();
-        else
-            return 0.0;
+        return final_time - start_time;
     }
 
     double getStartTime()
     {
-        if(data.size())
-            return data.begin()->timestamp();
-        else
-            return 0.0;
+        return start_time;
     }
 
 };
-
 }
 
 
@@ -0,0 +1,164 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "event-driven/core/compress.h"
+#include <cstring>
+
+namespace ev {
+
+namespace {
+
+using namespace aeWord;
+
+constexpr uint8_t has_ts = 0x01;
+
+inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+inline int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+inline void put(std::vector<uint8_t> &out, uint32_t v)
+{
+    while(v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+//returns false if the data ends before the varint does
+inline bool get(const uint8_t *&in, const uint8_t *end, uint32_t &v)
+{
+    v = 0;
+    for(int shift = 0; shift < 35 && in < end; shift += 7) {
+        uint8_t b = *in++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+}
+
+const std::string& compressor<AE>::tag()
+{
+    static const std::string t = "ZAE";
+    return t;
+}
+
+void compressor<AE>::encode(const AE *events, size_t n, std::vector<uint8_t> &out)
+{
+    const uint32_t *raw = (const uint32_t *)events;
+    out.clear();
+    out.reserve(n * 3 + n / 8 + 16);
+    put(out, n);
+    out.push_back(words == 2 ? has_ts : 0);
+
+    //runs of the upper bits, usually a single run per camera
+    for(size_t i = 0; i < n;) {
+        uint32_t c = raw[i * words + words - 1] >> c_shift;
+        size_t j = i + 1;
+        while(j < n && raw[j * words + words - 1] >> c_shift == c) j++;
+        put(out, j - i);
+        put(out, c);
+        i = j;
+    }
+
+    //polarity
+    size_t offset = out.size();
+    out.resize(offset + (n + 7) / 8, 0);
+    for(size_t i = 0; i < n; i++)
+        out[offset + i / 8] |= (raw[i * words + words - 1] & 1) << (i % 8);
+
+    //timestamps and coordinates
+    uint32_t prev_ts = 0;
+    int32_t prev_x = 0, prev_y = 0;
+    for(size_t i = 0; i < n; i++) {
+        if(words == 2) {
+            uint32_t ts = raw[i * words];
+            put(out, zigzag((int32_t)(ts - prev_ts)));
+            prev_ts = ts;
+        }
+        uint32_t w = raw[i * words + words - 1];
+        int32_t x = (w >> x_shift) & x_mask;
+        int32_t y = (w >> y_shift) & y_mask;
+        put(out, zigzag(x - prev_x) << 1 | (y != prev_y));
+        if(y != prev_y) put(out, zigzag(y - prev_y));
+        prev_x = x; prev_y = y;
+    }
+}
+
+size_t compressor<AE>::count(const uint8_t *data, size_t bytes)
+{
+    const uint8_t *end = data + bytes;
+    uint32_t n;
+    if(!get(data, end, n) || data >= end) return 0;
+    if(*data != (words == 2 ? has_ts : 0)) return 0;
+    //every event needs at least one byte of coordinates
+    if(n > bytes) return 0;
+    return n;
+}
+
+bool compressor<AE>::decode(const uint8_t *data, size_t bytes, AE *events, size_t n)
+{
+    uint32_t *raw = (uint32_t *)events;
+    const uint8_t *end = data + bytes;
+    uint32_t v;
+    if(!get(data, end, v) || v != n || data >= end) return false;
+    data++; //flags, checked by count()
+
+    for(size_t i = 0; i < n;) {
+        uint32_t length, c;
+        if(!get(data, end, length) || !get(data, end, c)) return false;
+        if(!length || length > n - i) return false;
+        for(size_t j = i + length; i < j; i++)
+            raw[i * words + words - 1] = c << c_shift;
+    }
+
+    const uint8_t *polarity = data;
+    data += (n + 7) / 8;
+    if(data > end) return false;
+    for(size_t i = 0; i < n; i++)
+        raw[i * words + words - 1] |= (polarity[i / 8] >> (i % 8)) & 1;
+
+    uint32_t ts = 0;
+    int32_t x = 0, y = 0;
+    for(size_t i = 0; i < n; i++) {
+        if(words == 2) {
+            if(!get(data, end, v)) return false;
+            ts += (uint32_t)unzigzag(v);
+            raw[i * words] = ts;
+        }
+        if(!get(data, end, v)) return false;
+        x += unzigzag(v >> 1);
+        if(v & 1) {
+            if(!get(data, end, v)) return false;
+            y += unzigzag(v);
+        }
+        raw[i * words + words - 1] |= ((uint32_t)x & x_mask) << x_shift |
+                                      ((uint32_t)y & y_mask) << y_shift;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,72 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "codec.h"
+
+namespace ev {
+
+/// \brief compressed wire format for a packet of T. Packets are sent with
+/// tag() in place of T::tag, so a reader accepts both formats. Types without
+/// a compressed format are always sent raw.
+template <typename T>
+struct compressor
+{
+    static constexpr bool available = false;
+
+    static const std::string& tag()
+    {
+        static const std::string none;
+        return none;
+    }
+
+    static void encode(const T *, size_t, std::vector<uint8_t> &out) { out.clear(); }
+    static size_t count(const uint8_t *, size_t) { return 0; }
+    static bool decode(const uint8_t *, size_t, T *, size_t) { return false; }
+};
+
+/// \brief ev::AE packets compressed to ~2-3 bytes per event (tag "ZAE")
+///
+/// [n][flags]
+/// [run length][bits 22-31] ... runs of the channel/type/skin/corner bits
+/// [polarity] n bits, packed 8 per byte
+/// per event: [ts delta] (ENABLE_TS only) [x delta, same row flag]([y delta])
+///
+/// all values are LEB128 varints, deltas are zig-zag encoded.
+template <>
+struct compressor<AE>
+{
+    static constexpr bool available = true;
+
+    static const std::string& tag();
+
+    /// \brief replace out with the compressed form of n events
+    static void encode(const AE *events, size_t n, std::vector<uint8_t> &out);
+
+    /// \brief number of events in compressed data, 0 if it is invalid
+    static size_t count(const uint8_t *data, size_t bytes);
+
+    /// \brief decompress count(data, bytes) events into events
+    static bool decode(const uint8_t *data, size_t bytes, AE *events, size_t n);
+};
+
+}
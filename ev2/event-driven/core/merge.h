@@ -0,0 +1,269 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cfloat>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+#include "comms.h"
+
+namespace ev {
+
+/// \brief merges the events of several ports into a single stream in time
+/// order. Each event is given a time in seconds from its packet envelope:
+/// with ENABLE_TS the event timestamp is used relative to the last event of
+/// the packet, otherwise events are spread evenly over the packet duration.
+///
+/// Events are released once every port has data up to their time, but never
+/// later than max_latency (seconds of data time) behind the newest event
+/// received on any port, so a silent port does not stall the others. Events
+/// that arrive after newer events have been released are passed on
+/// immediately and counted by lateEvents().
+template <typename T>
+class merged_window
+{
+public:
+
+    struct item
+    {
+        double timestamp;
+        unsigned int source;
+        T event;
+    };
+
+    using iterator = typename std::vector<item>::iterator;
+
+    explicit merged_window(double max_latency = 0.005) :
+        max_latency(max_latency), signal(std::make_shared<dataSignal>()) {}
+
+    ~merged_window()
+    {
+        stop();
+    }
+
+    /// \brief add an input port, events from it have source == sources() - 1
+    bool open(const std::string &name)
+    {
+        inputs.emplace_back(new stream);
+        if(!inputs.back()->input.open(name)) {
+            inputs.pop_back();
+            return false;
+        }
+        inputs.back()->input.notify(signal);
+        return true;
+    }
+
+    /// \brief add an input reading from the shared memory ring name
+    bool openShared(const std::string &name)
+    {
+        inputs.emplace_back(new stream);
+        if(!inputs.back()->input.openShared(name)) {
+            inputs.pop_back();
+            return false;
+        }
+        inputs.back()->input.notify(signal);
+        return true;
+    }
+
+    /// \brief add an input reading the packets of an open window
+    bool share(window<T> &source)
+    {
+        inputs.emplace_back(new stream);
+        if(!inputs.back()->input.share(source)) {
+            inputs.pop_back();
+            return false;
+        }
+        inputs.back()->input.notify(signal);
+        return true;
+    }
+
+    unsigned int sources() const
+    {
+        return inputs.size();
+    }
+
+    window<T>& input(unsigned int source)
+    {
+        return inputs[source]->input;
+    }
+
+    void setMaxLatency(double seconds)
+    {
+        max_latency = seconds;
+    }
+
+    void stop()
+    {
+        for(auto &s : inputs)
+            s->input.stop();
+    }
+
+    /// \brief events released since the last read, in time order. If
+    /// blocking, waits until there is at least one event or the inputs stop.
+    info readAll(bool blocking = true)
+    {
+        merged.clear();
+        _wait(blocking);
+        return _stats();
+    }
+
+    /// \brief the events released in the last seconds of data time before
+    /// the newest, including those of previous reads, in time order. If
+    /// blocking, waits until a new event is released or the inputs stop.
+    info readSlidingWinT(double seconds, bool blocking = true)
+    {
+        _wait(blocking);
+        if(!merged.empty()) {
+            double from = merged.back().timestamp - seconds;
+            auto first = merged.begin();
+            while(first != merged.end() && first->timestamp < from) first++;
+            merged.erase(merged.begin(), first);
+        }
+        return _stats();
+    }
+
+    iterator begin() { return merged.begin(); }
+    iterator end()   { return merged.end(); }
+
+    /// \brief events that arrived after newer events were released
+    size_t lateEvents() const
+    {
+        return late;
+    }
+
+private:
+
+    struct stream
+    {
+        window<T> input;
+        std::deque<item> queue;
+        double newest{-DBL_MAX};
+    };
+
+    std::vector< std::unique_ptr<stream> > inputs;
+    std::vector<item> merged;
+    double max_latency;
+    std::shared_ptr<dataSignal> signal;
+    double released{-DBL_MAX};
+    size_t late{0};
+
+    //release events into merged, sleeping until the inputs notify signal of
+    //a packet or that they stopped
+    void _wait(bool blocking)
+    {
+        size_t before = merged.size();
+        auto ready = [this, blocking, before] {
+            for(unsigned int i = 0; i < inputs.size(); i++)
+                _fetch(i);
+            _merge();
+            return merged.size() > before || !blocking || !_running();
+        };
+        if(ready()) return;
+        std::unique_lock<std::mutex> lk(signal->m);
+        signal->waiting++;
+        signal->cv.wait(lk, ready);
+        signal->waiting--;
+    }
+
+    info _stats() const
+    {
+        if(merged.empty())
+            return {0, 0.0, std::max(released, 0.0)};
+        return {(unsigned int)merged.size(),
+                merged.back().timestamp - merged.front().timestamp,
+                merged.back().timestamp};
+    }
+
+    bool _running()
+    {
+        for(auto &s : inputs)
+            if(!s->input.closed()) return true;
+        return false;
+    }
+
+#if ENABLE_TS
+    //time of each event from its timestamp
+    static double _time(const packet<T> &p, size_t i, std::true_type)
+    {
+        return p.timestamp() - deltaS(p[p.size() - 1].ts, p[i].ts);
+    }
+#endif
+
+    //time of each event interpolated over the packet
+    static double _time(const packet<T> &p, size_t i, std::false_type)
+    {
+        return p.timestamp() - p.duration() * (p.size() - 1 - i) / p.size();
+    }
+
+    //move the received packets of an input into its queue
+    void _fetch(unsigned int source)
+    {
+        stream &s = *inputs[source];
+        while(packet<T> *p = s.input.readPacket(false)) {
+            //const access reads shared memory packets in place
+            const packet<T> &events = *p;
+            for(size_t i = 0; i < events.size(); i++) {
+#if ENABLE_TS
+                double t = _time(events, i, std::is_base_of<timeStamp, T>());
+#else
+                double t = _time(events, i, std::false_type());
+#endif
+                s.queue.push_back({t, source, events[i]});
+            }
+            if(p->size())
+                s.newest = std::max(s.newest, s.queue.back().timestamp);
+        }
+    }
+
+    //k-way merge of the queued events up to the release time
+    void _merge()
+    {
+        double slowest = DBL_MAX, newest = -DBL_MAX;
+        for(auto &s : inputs) {
+            slowest = std::min(slowest, s->newest);
+            newest = std::max(newest, s->newest);
+        }
+        if(newest == -DBL_MAX) return;
+        //once the inputs stop, everything left can be released
+        double until = _running() ? std::max(slowest, newest - max_latency) : DBL_MAX;
+
+        using head = std::pair<double, unsigned int>;
+        std::priority_queue< head, std::vector<head>, std::greater<head> > heads;
+        for(unsigned int i = 0; i < inputs.size(); i++)
+            if(!inputs[i]->queue.empty())
+                heads.push({inputs[i]->queue.front().timestamp, i});
+
+        while(!heads.empty() && heads.top().first <= until) {
+            std::deque<item> &q = inputs[heads.top().second]->queue;
+            heads.pop();
+            if(q.front().timestamp < released) late++;
+            merged.push_back(q.front());
+            q.pop_front();
+            if(!q.empty())
+                heads.push({q.front().timestamp, merged.back().source});
+        }
+        if(until < DBL_MAX) released = std::max(released, until);
+    }
+
+};
+
+}
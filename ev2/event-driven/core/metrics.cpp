@@ -0,0 +1,320 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "event-driven/core/metrics.h"
+#include <yarp/os/LogStream.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ev {
+
+//utime + stime (clock ticks) from a /proc stat file, 0 if unavailable
+static uint64_t cpuTicks(const char *path)
+{
+    char buffer[1024];
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0) return 0;
+    ssize_t n = ::read(fd, buffer, sizeof(buffer) - 1);
+    ::close(fd);
+    if(n <= 0) return 0;
+    buffer[n] = '\0';
+
+    //the command name may contain spaces, fields restart after ')'
+    char *p = strrchr(buffer, ')');
+    if(!p) return 0;
+    p++;
+    //utime and stime are fields 14 and 15, the 12th and 13th after ')'
+    for(int field = 0; field < 11 && p; field++)
+        p = strchr(p + 1, ' ');
+    if(!p) return 0;
+    char *end;
+    uint64_t utime = strtoull(p, &end, 10);
+    uint64_t stime = strtoull(end, nullptr, 10);
+    return utime + stime;
+}
+
+template <typename M>
+static M& findOrAdd(std::mutex &m, std::deque<M> &metrics, const std::string &name)
+{
+    std::lock_guard<std::mutex> lk(m);
+    for(auto &n : metrics)
+        if(n.name == name) return n;
+    metrics.emplace_back(name);
+    return metrics.back();
+}
+
+metricCounter& threadMetrics::counter(const std::string &name)
+{
+    return findOrAdd(m, counters, name).metric;
+}
+
+metricGauge& threadMetrics::gauge(const std::string &name)
+{
+    return findOrAdd(m, gauges, name).metric;
+}
+
+metricHistogram& threadMetrics::histogram(const std::string &name)
+{
+    return findOrAdd(m, histograms, name).metric;
+}
+
+metrics::metrics(double period) : PeriodicThread(period)
+{
+    previous_time = std::chrono::steady_clock::now();
+    previous_ticks = cpuTicks("/proc/self/stat");
+}
+
+metrics::~metrics()
+{
+    close();
+}
+
+threadMetrics& metrics::thread(const std::string &name)
+{
+    int tid = (int)syscall(SYS_gettid);
+    std::lock_guard<std::mutex> lk(m);
+    for(auto &t : threads)
+        if(t->tid == tid && t->name == name) return *t;
+    threads.emplace_back(new threadMetrics(name, tid));
+    std::string path = "/proc/self/task/" + std::to_string(tid) + "/stat";
+    threads.back()->previous_ticks = cpuTicks(path.c_str());
+    return *threads.back();
+}
+
+bool metrics::open(const std::string &module, const std::string &prometheus_path)
+{
+    this->module = module;
+    this->prometheus_path = prometheus_path;
+    if(!port.open(module + "/metrics:o")) {
+        yError() << "Could not open metrics port" << module + "/metrics:o";
+        return false;
+    }
+    return start();
+}
+
+void metrics::close()
+{
+    stop();
+    port.close();
+}
+
+metricsSnapshot metrics::snapshot()
+{
+    std::lock_guard<std::mutex> lk(m);
+    static const double tick = 1.0 / sysconf(_SC_CLK_TCK);
+
+    metricsSnapshot s;
+    auto now = std::chrono::steady_clock::now();
+    s.period = std::chrono::duration<double>(now - previous_time).count();
+    previous_time = now;
+    double period = s.period > 0.0 ? s.period : 1.0;
+
+    uint64_t ticks = cpuTicks("/proc/self/stat");
+    s.cpu = (ticks - previous_ticks) * tick / period;
+    previous_ticks = ticks;
+
+    std::vector<uint64_t> bins;
+    for(auto &tp : threads) {
+        threadMetrics &t = *tp;
+        std::lock_guard<std::mutex> tlk(t.m);
+        s.threads.push_back({t.name, t.tid, 0.0, {}, {}, {}});
+        metricsSnapshot::thread &st = s.threads.back();
+
+        std::string path = "/proc/self/task/" + std::to_string(t.tid) + "/stat";
+        ticks = cpuTicks(path.c_str());
+        //the thread has finished
+        if(ticks < t.previous_ticks) ticks = t.previous_ticks;
+        st.cpu = (ticks - t.previous_ticks) * tick / period;
+        t.previous_ticks = ticks;
+
+        for(auto &c : t.counters) {
+            uint64_t v = c.metric.value();
+            st.counters.push_back({c.name, v, (v - c.previous) / period});
+            c.previous = v;
+        }
+
+        for(auto &g : t.gauges)
+            st.gauges.push_back({g.name, g.metric.value()});
+
+        for(auto &h : t.histograms) {
+            uint64_t sum;
+            h.metric.copy(bins, sum);
+            h.previous_bins.resize(bins.size(), 0);
+            uint64_t count = 0;
+            uint64_t total = 0;
+            for(size_t i = 0; i < bins.size(); i++) {
+                total += bins[i];
+                uint64_t delta = bins[i] - h.previous_bins[i];
+                h.previous_bins[i] = bins[i];
+                bins[i] = delta;
+                count += delta;
+            }
+            metricsSnapshot::histogram sh{h.name, count, total, sum, 0.0, 0, 0, 0, 0, 0};
+            if(count) {
+                sh.mean = (double)(sum - h.previous_sum) / count;
+                const double q[4] = {0.5, 0.9, 0.99, 0.999};
+                uint64_t *p[4] = {&sh.p50, &sh.p90, &sh.p99, &sh.p999};
+                uint64_t seen = 0;
+                int k = 0;
+                for(size_t i = 0; i < bins.size(); i++) {
+                    if(!bins[i]) continue;
+                    seen += bins[i];
+                    while(k < 4 && seen >= q[k] * count)
+                        *p[k++] = metricHistogram::value(i);
+                    sh.max = metricHistogram::value(i);
+                }
+            }
+            h.previous_sum = sum;
+            st.histograms.push_back(sh);
+        }
+    }
+    return s;
+}
+
+std::string metrics::summary(const metricsSnapshot &s)
+{
+    std::stringstream ss;
+    ss.precision(3);
+    ss << "cpu " << s.cpu * 100.0 << "%";
+    for(auto &t : s.threads) {
+        ss << std::endl << t.name << " [" << t.tid << "] cpu " << t.cpu * 100.0 << "%";
+        for(auto &c : t.counters)
+            ss << " | " << c.name << " " << c.rate << "/s";
+        for(auto &g : t.gauges)
+            ss << " | " << g.name << " " << g.value;
+        for(auto &h : t.histograms)
+            ss << " | " << h.name << " " << h.p50 << "/" << h.p99 << "/" << h.max
+               << " (p50/p99/max)";
+    }
+    return ss.str();
+}
+
+void metrics::publish(const metricsSnapshot &s)
+{
+    yarp::os::Bottle &b = port.prepare();
+    b.clear();
+    b.addFloat64(s.cpu);
+    for(auto &t : s.threads) {
+        yarp::os::Bottle &bt = b.addList();
+        bt.addString(t.name);
+        bt.addInt32(t.tid);
+        bt.addFloat64(t.cpu);
+        yarp::os::Bottle &bc = bt.addList();
+        for(auto &c : t.counters) {
+            yarp::os::Bottle &e = bc.addList();
+            e.addString(c.name);
+            e.addInt64(c.total);
+            e.addFloat64(c.rate);
+        }
+        yarp::os::Bottle &bg = bt.addList();
+        for(auto &g : t.gauges) {
+            yarp::os::Bottle &e = bg.addList();
+            e.addString(g.name);
+            e.addInt64(g.value);
+        }
+        yarp::os::Bottle &bh = bt.addList();
+        for(auto &h : t.histograms) {
+            yarp::os::Bottle &e = bh.addList();
+            e.addString(h.name);
+            e.addInt64(h.count);
+            e.addFloat64(h.mean);
+            e.addInt64(h.p50);
+            e.addInt64(h.p90);
+            e.addInt64(h.p99);
+            e.addInt64(h.p999);
+            e.addInt64(h.max);
+        }
+    }
+    port.write();
+}
+
+//prometheus metric names only allow [a-zA-Z0-9_]
+static std::string sanitise(const std::string &name)
+{
+    std::string s = name;
+    for(auto &c : s)
+        if(!isalnum(c) && c != '_') c = '_';
+    return s;
+}
+
+void metrics::writePrometheus(const metricsSnapshot &s)
+{
+    //lines are grouped by metric family, as the format requires
+    std::map<std::string, std::pair<std::string, std::stringstream> > families;
+    auto family = [&families](const std::string &name, const char *type) -> std::stringstream& {
+        auto &f = families[name];
+        f.first = type;
+        return f.second;
+    };
+
+    std::string labels = "module=\"" + module + "\"";
+    family("ev_process_cpu_ratio", "gauge") << "ev_process_cpu_ratio{" << labels << "} " << s.cpu << "\n";
+    for(auto &t : s.threads) {
+        std::string tl = labels + ",thread=\"" + t.name + "\",tid=\"" + std::to_string(t.tid) + "\"";
+        family("ev_thread_cpu_ratio", "gauge") << "ev_thread_cpu_ratio{" << tl << "} " << t.cpu << "\n";
+        for(auto &c : t.counters) {
+            std::string n = "ev_" + sanitise(c.name) + "_total";
+            family(n, "counter") << n << "{" << tl << "} " << c.total << "\n";
+        }
+        for(auto &g : t.gauges) {
+            std::string n = "ev_" + sanitise(g.name);
+            family(n, "gauge") << n << "{" << tl << "} " << g.value << "\n";
+        }
+        for(auto &h : t.histograms) {
+            std::string n = "ev_" + sanitise(h.name);
+            std::stringstream &f = family(n, "summary");
+            f << n << "{" << tl << ",quantile=\"0.5\"} " << h.p50 << "\n";
+            f << n << "{" << tl << ",quantile=\"0.9\"} " << h.p90 << "\n";
+            f << n << "{" << tl << ",quantile=\"0.99\"} " << h.p99 << "\n";
+            f << n << "{" << tl << ",quantile=\"0.999\"} " << h.p999 << "\n";
+            f << n << "_sum{" << tl << "} " << h.sum << "\n";
+            f << n << "_count{" << tl << "} " << h.total << "\n";
+        }
+    }
+
+    //write to a temporary file and rename, so readers never see half a file
+    std::string temporary = prometheus_path + ".tmp";
+    FILE *fp = fopen(temporary.c_str(), "w");
+    if(!fp) {
+        yWarning() << "Could not write metrics to" << temporary;
+        return;
+    }
+    for(auto &f : families) {
+        fprintf(fp, "# TYPE %s %s\n", f.first.c_str(), f.second.first.c_str());
+        fputs(f.second.second.str().c_str(), fp);
+    }
+    fclose(fp);
+    if(rename(temporary.c_str(), prometheus_path.c_str()))
+        yWarning() << "Could not write metrics to" << prometheus_path;
+}
+
+void metrics::run()
+{
+    metricsSnapshot s = snapshot();
+    publish(s);
+    if(!prometheus_path.empty())
+        writePrometheus(s);
+}
+
+}
@@ -0,0 +1,243 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/PeriodicThread.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ev {
+
+/// \brief a count that only grows, e.g. events, packets or bytes. Written by
+/// a single thread without locks, read by the publisher at any time.
+class metricCounter
+{
+public:
+    inline void add(uint64_t n = 1)
+    {
+        //single writer: no read-modify-write needed
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    uint64_t value() const { return v.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> v{0};
+};
+
+/// \brief an instantaneous value, e.g. a queue depth. Can be set by any
+/// thread.
+class metricGauge
+{
+public:
+    inline void set(int64_t value) { v.store(value, std::memory_order_relaxed); }
+    int64_t value() const { return v.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> v{0};
+};
+
+/// \brief an HDR histogram of integer values (e.g. nanoseconds) from 0 to
+/// 2^40 with ~1.5% resolution. Written by a single thread without locks.
+class metricHistogram
+{
+public:
+
+    static constexpr int sub_bits = 7;
+    static constexpr int max_bits = 40;
+    static constexpr int sub_count = 1 << sub_bits;
+    static constexpr int half_count = sub_count / 2;
+    static constexpr int buckets = sub_count + (max_bits - sub_bits + 1) * half_count;
+
+    metricHistogram() : bins(new std::atomic<uint64_t>[buckets])
+    {
+        for(int i = 0; i < buckets; i++) bins[i] = 0;
+    }
+
+    inline void record(uint64_t value)
+    {
+        std::atomic<uint64_t> &b = bins[index(value)];
+        b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static inline int index(uint64_t value)
+    {
+        if(value < (uint64_t)sub_count) return (int)value;
+        int msb = 63 - __builtin_clzll(value);
+        if(msb >= max_bits) return buckets - 1;
+        int e = msb - (sub_bits - 1);
+        return sub_count + (e - 1) * half_count + (int)(value >> e) - half_count;
+    }
+
+    /// \brief the largest value counted in bucket i
+    static inline uint64_t value(int i)
+    {
+        if(i < sub_count) return i;
+        int e = (i - sub_count) / half_count + 1;
+        uint64_t sub = (i - sub_count) % half_count + half_count;
+        return ((sub + 1) << e) - 1;
+    }
+
+    /// \brief copy the bucket counts and total
+    void copy(std::vector<uint64_t> &counts, uint64_t &total) const
+    {
+        counts.resize(buckets);
+        for(int i = 0; i < buckets; i++)
+            counts[i] = bins[i].load(std::memory_order_relaxed);
+        total = sum.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> bins;
+    std::atomic<uint64_t> sum{0};
+};
+
+/// \brief records the nanoseconds from construction to destruction
+class metricTimer
+{
+public:
+    explicit metricTimer(metricHistogram &h) : h(h), start(std::chrono::steady_clock::now()) {}
+    ~metricTimer()
+    {
+        h.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    metricHistogram &h;
+    std::chrono::steady_clock::time_point start;
+};
+
+/// \brief the metrics written by one thread. Metrics are created once (with
+/// a lock) and then updated without locks; references remain valid for the
+/// lifetime of the registry.
+class threadMetrics
+{
+public:
+
+    threadMetrics(const std::string &name, int tid) : name(name), tid(tid) {}
+
+    metricCounter& counter(const std::string &name);
+    metricGauge& gauge(const std::string &name);
+    metricHistogram& histogram(const std::string &name);
+
+private:
+
+    friend class metrics;
+
+    template <typename M> struct named
+    {
+        explicit named(const std::string &name) : name(name) {}
+        std::string name;
+        M metric;
+        //state at the previous snapshot
+        uint64_t previous{0};
+        std::vector<uint64_t> previous_bins;
+        uint64_t previous_sum{0};
+    };
+
+    std::string name;
+    int tid;
+    uint64_t previous_ticks{0};
+    std::mutex m;
+    std::deque< named<metricCounter> > counters;
+    std::deque< named<metricGauge> > gauges;
+    std::deque< named<metricHistogram> > histograms;
+};
+
+/// \brief the metrics over the interval between two snapshots
+struct metricsSnapshot
+{
+    struct counter { std::string name; uint64_t total; double rate; };
+    struct gauge { std::string name; int64_t value; };
+    struct histogram {
+        std::string name;
+        //in this interval, and since the start
+        uint64_t count, total, sum;
+        double mean;
+        uint64_t p50, p90, p99, p999, max;
+    };
+    struct thread {
+        std::string name;
+        int tid;
+        double cpu;
+        std::vector<counter> counters;
+        std::vector<gauge> gauges;
+        std::vector<histogram> histograms;
+    };
+
+    double period{0.0};
+    double cpu{0.0};
+    std::vector<thread> threads;
+};
+
+/// \brief a registry of per-thread counters, gauges and histograms. Hot
+/// paths update their metrics without locks; once per period a snapshot is
+/// taken and published on <module>/metrics:o as a bottle of
+///     process_cpu (thread tid cpu (counters) (gauges) (histograms)) ...
+/// where counters are (name total rate/s), gauges (name value) and
+/// histograms (name count mean p50 p90 p99 p999 max). CPU usage is the
+/// fraction of one core, read from /proc/self/task. Optionally the snapshot
+/// is also written to a Prometheus text file (e.g. for the node exporter).
+class metrics : public yarp::os::PeriodicThread
+{
+public:
+
+    metrics(double period = 1.0);
+    ~metrics();
+
+    /// \brief the metrics of the calling thread, created on first use.
+    /// Call it from the thread that will write the metrics.
+    threadMetrics& thread(const std::string &name);
+
+    bool open(const std::string &module, const std::string &prometheus_path = "");
+    void close();
+
+    /// \brief the metrics since the previous snapshot. The publishing
+    /// thread takes a snapshot each period, so only call this directly if
+    /// the registry is not open.
+    metricsSnapshot snapshot();
+
+    /// \brief a snapshot as text, for logging
+    static std::string summary(const metricsSnapshot &s);
+
+private:
+
+    std::mutex m;
+    std::deque< std::unique_ptr<threadMetrics> > threads;
+    std::string module;
+    std::string prometheus_path;
+    yarp::os::BufferedPort<yarp::os::Bottle> port;
+    std::chrono::steady_clock::time_point previous_time;
+    uint64_t previous_ticks{0};
+
+    void publish(const metricsSnapshot &s);
+    void writePrometheus(const metricsSnapshot &s);
+    void run() override;
+};
+
+}
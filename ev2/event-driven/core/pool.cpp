@@ -0,0 +1,108 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "event-driven/core/pool.h"
+
+namespace ev {
+
+threadPool::threadPool(unsigned int threads)
+{
+    if(!threads) threads = std::thread::hardware_concurrency();
+    for(unsigned int i = 1; i < threads; i++)
+        workers.emplace_back([this]{work();});
+}
+
+threadPool::~threadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(auto &w : workers)
+        w.join();
+}
+
+threadPool &threadPool::shared()
+{
+    static threadPool pool;
+    return pool;
+}
+
+void threadPool::take(const std::function<void(size_t)> &task, size_t n)
+{
+    for(size_t i = next++; i < n; i = next++) {
+        task(i);
+        if(++completed == n) {
+            std::lock_guard<std::mutex> lock(m);
+            finished.notify_all();
+        }
+    }
+}
+
+void threadPool::run(size_t n, const std::function<void(size_t)> &task)
+{
+    if(!n) return;
+    if(workers.empty() || n == 1) {
+        for(size_t i = 0; i < n; i++) task(i);
+        return;
+    }
+
+    //the workers and counters serve one job at a time
+    std::lock_guard<std::mutex> running(run_m);
+    {
+        std::lock_guard<std::mutex> lock(m);
+        job = &task;
+        n_tasks = n;
+        next = 0;
+        completed = 0;
+        generation++;
+    }
+    wake.notify_all();
+
+    take(task, n);
+
+    //workers still looking for a task must leave before the next run()
+    //resets the counters
+    std::unique_lock<std::mutex> lock(m);
+    finished.wait(lock, [this, n]{return completed == n && busy == 0;});
+    job = nullptr;
+}
+
+void threadPool::work()
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(m);
+    while(true) {
+        wake.wait(lock, [this, &seen]{return stopping || generation != seen;});
+        if(stopping) return;
+        seen = generation;
+        if(!job) continue;
+        const std::function<void(size_t)> &task = *job;
+        size_t n = n_tasks;
+        busy++;
+        lock.unlock();
+
+        take(task, n);
+
+        lock.lock();
+        if(--busy == 0) finished.notify_all();
+    }
+}
+
+}
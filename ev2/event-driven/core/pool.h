@@ -0,0 +1,77 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ev {
+
+/// \brief a fixed set of worker threads running the tasks of a parallel
+/// loop. The thread calling run() also takes tasks, so a pool of size 1 has
+/// no workers and runs everything on the caller.
+class threadPool
+{
+public:
+
+    /// \brief threads = 0 uses one thread per core
+    explicit threadPool(unsigned int threads = 0);
+    ~threadPool();
+    threadPool(const threadPool&) = delete;
+    threadPool& operator=(const threadPool&) = delete;
+
+    /// \brief the threads taking part in run(), including the caller
+    unsigned int size() const { return (unsigned int)workers.size() + 1; }
+
+    /// \brief call task(i) for each i in [0, n), in any order and on any of
+    /// the threads, returning once all have finished. Calls from several
+    /// threads take turns with the workers. A task must not call run() on
+    /// the same pool.
+    void run(size_t n, const std::function<void(size_t)> &task);
+
+    /// \brief a pool with one thread per core, started on first use
+    static threadPool &shared();
+
+private:
+
+    std::vector<std::thread> workers;
+    //held by the caller of run() for the whole job
+    std::mutex run_m;
+    std::mutex m;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(size_t)> *job{nullptr};
+    size_t n_tasks{0};
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> completed{0};
+    unsigned int busy{0};
+    uint64_t generation{0};
+    bool stopping{false};
+
+    void work();
+    void take(const std::function<void(size_t)> &task, size_t n);
+};
+
+}
@@ -0,0 +1,92 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <event-driven/core/recording.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+
+namespace ev {
+
+bool isBinaryRecording(const std::string &path)
+{
+    std::ifstream reader(path, std::ios::binary);
+    if(!reader.is_open()) return false;
+    char magic[sizeof(recording_magic)] = {0};
+    reader.read(magic, sizeof(magic));
+    return reader.gcount() == sizeof(magic) &&
+           std::memcmp(magic, recording_magic, sizeof(magic)) == 0;
+}
+
+mappedFile::~mappedFile()
+{
+    close();
+}
+
+bool mappedFile::open(const std::string &path)
+{
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        yError() << "[mmap] could not open" << path << std::strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || st.st_size == 0) {
+        yError() << "[mmap] could not stat" << path;
+        close();
+        return false;
+    }
+    bytes = st.st_size;
+
+    //private, writeable mapping: modified pages are copied, never written back
+    void *m = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(m == MAP_FAILED) {
+        yError() << "[mmap] could not map" << path << std::strerror(errno);
+        close();
+        return false;
+    }
+    ptr = (char *)m;
+    return true;
+}
+
+void mappedFile::close()
+{
+    if(ptr) munmap(ptr, bytes);
+    if(fd >= 0) ::close(fd);
+    ptr = nullptr;
+    fd = -1;
+    bytes = 0;
+}
+
+void mappedFile::adviseSequential(size_t offset, size_t length)
+{
+    if(!ptr || offset >= bytes) return;
+    //madvise requires a page aligned address
+    static const size_t page = sysconf(_SC_PAGESIZE);
+    size_t aligned = offset - offset % page;
+    length = std::min(length + (offset - aligned), bytes - aligned);
+    madvise(ptr + aligned, length, MADV_SEQUENTIAL);
+}
+
+}
@@ -0,0 +1,193 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <yarp/os/LogStream.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+
+namespace ev {
+
+// binary recording layout (all little-endian, native event structs)
+//
+// [recordingHeader]
+// [packetHeader][T * count] ... one block per packet
+// [packetIndex * packets]      footer index, 8-byte aligned
+// [recordingTrailer]
+//
+// the footer index is used in-place from the memory mapping so opening a
+// recording does not depend on its length.
+
+static constexpr char recording_magic[8] = {'E', 'V', '2', 'B', 'I', 'N', '0', '1'};
+
+/// \brief first block of a binary recording
+struct recordingHeader {
+    char magic[8];
+    char tag[8];
+    uint32_t event_size;
+    uint32_t version;
+    uint64_t reserved;
+};
+
+/// \brief header preceding the events of each packet in a binary recording
+struct packetHeader {
+    int32_t id;
+    uint32_t count;
+    double timestamp;
+    double duration;
+};
+
+/// \brief footer index entry. offset is the byte offset of the first event
+/// of the packet from the start of the file (offlineLoader uses it from the
+/// start of its own event storage for text logs)
+struct packetIndex {
+    double timestamp;
+    double duration;
+    int32_t id;
+    uint32_t count;
+    uint64_t offset;
+};
+
+/// \brief final block of a binary recording, locates the footer index
+struct recordingTrailer {
+    uint64_t index_offset;
+    uint64_t packets;
+    uint64_t events;
+    char magic[8];
+};
+
+/// \brief check if the file at path starts with the binary recording magic
+bool isBinaryRecording(const std::string &path);
+
+/// \brief read-only view of a whole file through mmap. Pages are copy-on-write
+/// so events can be modified in place without touching the file on disk.
+class mappedFile
+{
+private:
+    int fd{-1};
+    char *ptr{nullptr};
+    size_t bytes{0};
+
+public:
+
+    mappedFile() = default;
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+    ~mappedFile();
+
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return ptr != nullptr; }
+    char* data() const { return ptr; }
+    size_t size() const { return bytes; }
+
+    /// \brief hint the kernel that [offset, offset+length) is read sequentially
+    void adviseSequential(size_t offset, size_t length);
+};
+
+/// \brief writes ev::packet data to the binary recording format read by
+/// ev::offlineLoader
+template <typename T>
+class offlineWriter
+{
+private:
+    std::ofstream writer;
+    std::vector<packetIndex> index;
+    uint64_t position{0};
+    uint64_t event_count{0};
+
+public:
+
+    ~offlineWriter()
+    {
+        close();
+    }
+
+    bool open(const std::string &path)
+    {
+        writer.open(path, std::ios::binary | std::ios::trunc);
+        if(!writer.is_open()) {
+            yError() << "Could not open" << path << "for writing";
+            return false;
+        }
+
+        recordingHeader header{};
+        std::memcpy(header.magic, recording_magic, sizeof(recording_magic));
+        std::strncpy(header.tag, T::tag.c_str(), sizeof(header.tag));
+        header.event_size = sizeof(T);
+        header.version = 1;
+        writer.write((const char *)&header, sizeof(header));
+        position = sizeof(header);
+        index.clear();
+        event_count = 0;
+        return writer.good();
+    }
+
+    bool write(const T *data, uint32_t count, double timestamp, double duration, int32_t id)
+    {
+        if(!writer.is_open()) return false;
+
+        packetHeader ph{id, count, timestamp, duration};
+        writer.write((const char *)&ph, sizeof(ph));
+        position += sizeof(ph);
+
+        index.push_back({timestamp, duration, id, count, position});
+        writer.write((const char *)data, count * sizeof(T));
+        position += count * sizeof(T);
+        event_count += count;
+        return writer.good();
+    }
+
+    template <typename P>
+    bool write(P &p)
+    {
+        const T *data = p.size() ? &(*p.begin()) : nullptr;
+        return write(data, p.size(), p.timestamp(), p.duration(), p.id());
+    }
+
+    bool close()
+    {
+        if(!writer.is_open()) return false;
+
+        //pad to keep the index aligned for in-place use
+        static const char zeros[8] = {0};
+        if(position % 8) {
+            writer.write(zeros, 8 - position % 8);
+            position += 8 - position % 8;
+        }
+
+        recordingTrailer trailer{};
+        trailer.index_offset = position;
+        trailer.packets = index.size();
+        trailer.events = event_count;
+        std::memcpy(trailer.magic, recording_magic, sizeof(recording_magic));
+
+        writer.write((const char *)index.data(), index.size() * sizeof(packetIndex));
+        writer.write((const char *)&trailer, sizeof(trailer));
+        bool good = writer.good();
+        writer.close();
+        index.clear();
+        return good;
+    }
+};
+
+}
@@ -0,0 +1,439 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "event-driven/core/shmem.h"
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+
+namespace ev {
+
+static constexpr char shmem_magic[8] = {'E', 'V', '2', 'S', 'H', 'M', '0', '1'};
+
+struct shmemRing::shmemControl {
+    char magic[8];
+    char tag[8];
+    uint32_t event_size;
+    uint32_t slots;
+    uint64_t slot_events;
+    uint64_t slot_stride;
+    uint64_t slot_offset;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint64_t head;
+    int32_t writer_open;
+    struct {
+        int32_t pid;
+        uint64_t next; //oldest packet still held
+    } readers[max_readers];
+};
+
+namespace {
+
+std::string shmemName(const std::string &name)
+{
+    std::string shm = "/ev";
+    for(auto c : name) shm.push_back(c == '/' ? '_' : c);
+    return shm;
+}
+
+size_t alignTo(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//a process that died holding the mutex leaves it inconsistent
+void lock(pthread_mutex_t *m)
+{
+    if(pthread_mutex_lock(m) == EOWNERDEAD)
+        pthread_mutex_consistent(m);
+}
+
+//the byte of the segment file locked by the writer, and by reader i at
+//reader_byte + i
+const off_t writer_byte = 0;
+const off_t reader_byte = 1;
+
+bool lockByte(int fd, off_t byte)
+{
+    struct flock fl;
+    std::memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = byte;
+    fl.l_len = 1;
+    return fcntl(fd, F_OFD_SETLK, &fl) == 0;
+}
+
+//whether the byte is locked through another open of the file
+bool byteLocked(int fd, off_t byte)
+{
+    struct flock fl;
+    std::memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = byte;
+    fl.l_len = 1;
+    if(fcntl(fd, F_OFD_GETLK, &fl) < 0) return true;
+    return fl.l_type != F_UNLCK;
+}
+
+void timedWait(pthread_cond_t *c, pthread_mutex_t *m, long ms)
+{
+    timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    t.tv_nsec += ms * 1000000;
+    t.tv_sec += t.tv_nsec / 1000000000;
+    t.tv_nsec %= 1000000000;
+    if(pthread_cond_timedwait(c, m, &t) == EOWNERDEAD)
+        pthread_mutex_consistent(m);
+}
+
+}
+
+shmemRing::~shmemRing()
+{
+    close();
+}
+
+size_t shmemRing::slotEvents() const
+{
+    return control ? control->slot_events : 0;
+}
+
+size_t shmemRing::slots() const
+{
+    return control ? control->slots : 0;
+}
+
+shmemSlot* shmemRing::slot(uint64_t seq) const
+{
+    return (shmemSlot *)(segment + control->slot_offset + (seq % control->slots) * control->slot_stride);
+}
+
+bool shmemRing::map(int fd, size_t length, bool writable)
+{
+    void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(ptr == MAP_FAILED) {
+        yError() << "[shmem] could not map" << shm_name << std::strerror(errno);
+        return false;
+    }
+    segment = (char *)ptr;
+    bytes = length;
+    control = (shmemControl *)segment;
+
+    //readers can only change the control block
+    if(!writable) {
+        size_t offset = alignTo(sizeof(shmemControl), sysconf(_SC_PAGESIZE));
+        mprotect(segment + offset, bytes - offset, PROT_READ);
+    }
+    return true;
+}
+
+//mark the segment of a writer that has exited as closed, so readers still
+//attached to it stop waiting for packets
+void shmemRing::retire(int fd)
+{
+    struct stat sb;
+    if(fstat(fd, &sb) < 0 || (size_t)sb.st_size < sizeof(shmemControl)) return;
+    void *ptr = mmap(nullptr, sizeof(shmemControl), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(ptr == MAP_FAILED) return;
+    auto *old = (shmemControl *)ptr;
+    if(!std::memcmp(old->magic, shmem_magic, sizeof(shmem_magic))) {
+        lock(&old->mutex);
+        old->writer_open = 0;
+        pthread_cond_broadcast(&old->cond);
+        pthread_mutex_unlock(&old->mutex);
+    }
+    munmap(ptr, sizeof(shmemControl));
+}
+
+bool shmemRing::create(const std::string &name, const std::string &tag, size_t event_size,
+                       unsigned int slots, size_t slot_events)
+{
+    close();
+    shm_name = shmemName(name);
+    if(slots < 2) slots = 2;
+
+    size_t offset = alignTo(sizeof(shmemControl), sysconf(_SC_PAGESIZE));
+    size_t stride = alignTo(sizeof(shmemSlot) + slot_events * event_size, 64);
+    size_t length = offset + stride * slots;
+
+    //a previous writer that did not close leaves the old segment behind
+    fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+    if(fd >= 0) {
+        bool in_use = byteLocked(fd, writer_byte);
+        if(!in_use) retire(fd);
+        ::close(fd);
+        fd = -1;
+        if(in_use) {
+            yError() << "[shmem]" << shm_name << "already has a writer";
+            return false;
+        }
+        shm_unlink(shm_name.c_str());
+    }
+
+    fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+    if(fd < 0) {
+        yError() << "[shmem] could not create" << shm_name << std::strerror(errno);
+        return false;
+    }
+    if(!lockByte(fd, writer_byte) || ftruncate(fd, length) < 0 || !map(fd, length, true)) {
+        yError() << "[shmem] could not size" << shm_name << std::strerror(errno);
+        ::close(fd);
+        fd = -1;
+        shm_unlink(shm_name.c_str());
+        control = nullptr;
+        return false;
+    }
+
+    std::memset(control, 0, sizeof(shmemControl));
+    std::strncpy(control->tag, tag.c_str(), sizeof(control->tag));
+    control->event_size = event_size;
+    control->slots = slots;
+    control->slot_events = slot_events;
+    control->slot_stride = stride;
+    control->slot_offset = offset;
+
+    pthread_mutexattr_t ma;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&ma, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&control->mutex, &ma);
+    pthread_mutexattr_destroy(&ma);
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&control->cond, &ca);
+    pthread_condattr_destroy(&ca);
+
+    control->writer_open = 1;
+    std::memcpy(control->magic, shmem_magic, sizeof(shmem_magic));
+    writer = true;
+    interrupted = false;
+    return true;
+}
+
+bool shmemRing::attach(const std::string &name, const std::string &tag, size_t event_size)
+{
+    close();
+    shm_name = shmemName(name);
+
+    fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+    if(fd < 0 || !byteLocked(fd, writer_byte)) {
+        yError() << "[shmem] no shared memory writer for" << name;
+        if(fd >= 0) ::close(fd);
+        fd = -1;
+        return false;
+    }
+    struct stat sb;
+    if(fstat(fd, &sb) < 0 || (size_t)sb.st_size < sizeof(shmemControl) || !map(fd, sb.st_size, false)) {
+        ::close(fd);
+        fd = -1;
+        control = nullptr;
+        return false;
+    }
+
+    if(std::memcmp(control->magic, shmem_magic, sizeof(shmem_magic)) ||
+       control->event_size != event_size ||
+       std::strncmp(control->tag, tag.c_str(), sizeof(control->tag))) {
+        yError() << "[shmem]" << name << "does not contain" << tag << "events";
+        munmap(segment, bytes);
+        ::close(fd);
+        fd = -1;
+        control = nullptr;
+        return false;
+    }
+
+    lock(&control->mutex);
+    removeDeadReaders();
+    for(unsigned int i = 0; i < max_readers; i++) {
+        if(control->readers[i].pid == 0 && lockByte(fd, reader_byte + i)) {
+            reader_index = i;
+            break;
+        }
+    }
+    if(reader_index >= 0) {
+        cursor = control->head;
+        control->readers[reader_index].pid = getpid();
+        control->readers[reader_index].next = cursor;
+    }
+    pthread_mutex_unlock(&control->mutex);
+
+    if(reader_index < 0) {
+        yError() << "[shmem] too many readers attached to" << name;
+        munmap(segment, bytes);
+        ::close(fd);
+        fd = -1;
+        control = nullptr;
+        return false;
+    }
+
+    writer = false;
+    interrupted = false;
+    lost = 0;
+    return true;
+}
+
+void shmemRing::close()
+{
+    if(!control) return;
+
+    lock(&control->mutex);
+    if(writer)
+        control->writer_open = 0;
+    else if(reader_index >= 0)
+        control->readers[reader_index].pid = 0;
+    pthread_cond_broadcast(&control->cond);
+    pthread_mutex_unlock(&control->mutex);
+
+    munmap(segment, bytes);
+    if(writer) shm_unlink(shm_name.c_str());
+    //also releases the lock
+    ::close(fd);
+    fd = -1;
+    control = nullptr;
+    segment = nullptr;
+    reader_index = -1;
+    writer = false;
+}
+
+//a reader that exited without closing no longer holds its lock
+void shmemRing::removeDeadReaders()
+{
+    for(unsigned int i = 0; i < max_readers; i++)
+        if(control->readers[i].pid && !byteLocked(fd, reader_byte + i))
+            control->readers[i].pid = 0;
+}
+
+bool shmemRing::writerAlive() const
+{
+    return control->writer_open && byteLocked(fd, writer_byte);
+}
+
+shmemSlot* shmemRing::acquire()
+{
+    if(!control || !writer) return nullptr;
+
+    lock(&control->mutex);
+    const uint64_t seq = control->head;
+    while(!interrupted) {
+        bool held = false;
+        for(auto &r : control->readers)
+            if(r.pid && r.next + control->slots <= seq) held = true;
+        if(!held) break;
+        removeDeadReaders();
+        timedWait(&control->cond, &control->mutex, 50);
+    }
+    bool stop = interrupted;
+    pthread_mutex_unlock(&control->mutex);
+
+    return stop ? nullptr : slot(seq);
+}
+
+void shmemRing::publish(shmemSlot *s)
+{
+    lock(&control->mutex);
+    s->seq = control->head;
+    control->head++;
+    pthread_cond_broadcast(&control->cond);
+    pthread_mutex_unlock(&control->mutex);
+}
+
+//with the mutex held: wait for the packet at the cursor and take it
+const shmemSlot* shmemRing::take(bool wait)
+{
+    while(control->head <= cursor) {
+        if(!wait || interrupted || !writerAlive())
+            return nullptr;
+        timedWait(&control->cond, &control->mutex, 100);
+    }
+
+    //only possible if this reader was considered dead
+    auto &r = control->readers[reader_index];
+    if(control->head - cursor > control->slots) {
+        lost += control->head - control->slots - cursor;
+        cursor = control->head - control->slots;
+        r.next = std::max(r.next, cursor);
+    }
+    r.pid = getpid();
+    return slot(cursor++);
+}
+
+const shmemSlot* shmemRing::next(bool wait)
+{
+    if(!control || writer) return nullptr;
+
+    lock(&control->mutex);
+    control->readers[reader_index].next = cursor;
+    pthread_cond_broadcast(&control->cond);
+    const shmemSlot *s = take(wait);
+    pthread_mutex_unlock(&control->mutex);
+    return s;
+}
+
+const shmemSlot* shmemRing::hold(bool wait)
+{
+    if(!control || writer) return nullptr;
+
+    lock(&control->mutex);
+    const shmemSlot *s = take(wait);
+    pthread_mutex_unlock(&control->mutex);
+    return s;
+}
+
+void shmemRing::release()
+{
+    if(!control || writer) return;
+    lock(&control->mutex);
+    control->readers[reader_index].next = cursor;
+    pthread_cond_broadcast(&control->cond);
+    pthread_mutex_unlock(&control->mutex);
+}
+
+void shmemRing::release(uint64_t seq)
+{
+    if(!control || writer) return;
+    lock(&control->mutex);
+    auto &r = control->readers[reader_index];
+    if(seq > r.next) {
+        r.next = seq;
+        pthread_cond_broadcast(&control->cond);
+    }
+    pthread_mutex_unlock(&control->mutex);
+}
+
+void shmemRing::interrupt()
+{
+    if(!control) {
+        interrupted = true;
+        return;
+    }
+    lock(&control->mutex);
+    interrupted = true;
+    pthread_cond_broadcast(&control->cond);
+    pthread_mutex_unlock(&control->mutex);
+}
+
+}
@@ -0,0 +1,282 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Stamp.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace ev {
+
+// shared memory ring layout
+//
+// [shmemControl]  process-shared mutex/condition, write head, reader cursors
+// [shmemSlot][T * slot_events] * slots, each slot 64-byte aligned
+//
+// a single writer fills each packet in the next slot. Readers map the segment
+// read-only and use the events in-place, holding any number of packets. The
+// writer does not reuse a slot until every attached reader has released it.
+//
+// while attached, the writer and each reader hold a lock on their own byte of
+// the segment file. The locks belong to the open file, so they are released
+// when a process exits however it ends, and can be checked from any pid
+// namespace.
+
+/// \brief packet envelope stored at the start of each shared memory slot
+struct shmemSlot {
+    uint64_t seq;
+    int32_t id;
+    uint32_t count;
+    double timestamp;
+    double duration;
+    uint64_t reserved;
+};
+
+/// \brief untyped shared memory ring used by ev::shmemWriter and
+/// ev::shmemReader
+class shmemRing
+{
+public:
+
+    static constexpr unsigned int max_readers = 16;
+
+    shmemRing() = default;
+    shmemRing(const shmemRing&) = delete;
+    shmemRing& operator=(const shmemRing&) = delete;
+    ~shmemRing();
+
+    /// \brief create the segment for name. A segment left by a writer that
+    /// has exited is replaced, waking any readers still attached to it.
+    /// Fails if another writer is using it.
+    bool create(const std::string &name, const std::string &tag, size_t event_size,
+                unsigned int slots, size_t slot_events);
+
+    /// \brief attach to the segment created by a writer and register as a
+    /// reader starting at the next packet written
+    bool attach(const std::string &name, const std::string &tag, size_t event_size);
+
+    void close();
+    bool isOpen() const { return control != nullptr; }
+    size_t slotEvents() const;
+    size_t slots() const;
+
+    /// \brief writer: block until the next slot is free of readers, or the
+    /// ring is closed. Returns the slot to fill.
+    shmemSlot* acquire();
+
+    /// \brief writer: publish the slot returned by acquire
+    void publish(shmemSlot *slot);
+
+    /// \brief reader: release the previous packet and return the next one.
+    /// Returns nullptr if not waiting and nothing is available, or if the
+    /// ring is interrupted.
+    const shmemSlot* next(bool wait);
+
+    /// \brief reader: return the next packet, keeping the packets returned
+    /// before it until release(seq)
+    const shmemSlot* hold(bool wait);
+
+    /// \brief reader: release all held packets without reading further
+    void release();
+
+    /// \brief reader: release the held packets before sequence number seq
+    void release(uint64_t seq);
+
+    /// \brief wake any blocked acquire/next calls, which return nullptr
+    void interrupt();
+    void resume() { interrupted = false; }
+
+    /// \brief packets skipped by this reader after being detached as unresponsive
+    uint64_t dropped() const { return lost; }
+
+    static inline const char* events(const shmemSlot *slot)
+    {
+        return (const char *)slot + sizeof(shmemSlot);
+    }
+
+    static inline char* events(shmemSlot *slot)
+    {
+        return (char *)slot + sizeof(shmemSlot);
+    }
+
+private:
+
+    struct shmemControl;
+
+    shmemControl *control{nullptr};
+    char *segment{nullptr};
+    size_t bytes{0};
+    int fd{-1};
+    std::string shm_name;
+    bool writer{false};
+    int reader_index{-1};
+    uint64_t cursor{0};
+    uint64_t lost{0};
+    bool interrupted{false};
+
+    shmemSlot* slot(uint64_t seq) const;
+    const shmemSlot* take(bool wait);
+    bool map(int fd, size_t length, bool writable);
+    void removeDeadReaders();
+    bool writerAlive() const;
+    static void retire(int fd);
+};
+
+/// \brief writes ev::packet data into a shared memory ring read by
+/// ev::shmemReader in other processes on the same host
+template <typename T>
+class shmemWriter
+{
+private:
+    shmemRing ring;
+    //slot acquired by prepare() and not yet published
+    shmemSlot *pending{nullptr};
+
+    void publish(shmemSlot *slot, size_t count, const yarp::os::Stamp &stamp, double duration)
+    {
+        slot->id = stamp.getCount();
+        slot->timestamp = stamp.getTime();
+        slot->duration = duration;
+        slot->count = count;
+        ring.publish(slot);
+    }
+
+public:
+
+    /// \brief create the ring of slots packets of up to slot_events events.
+    /// Larger packets are split across slots.
+    bool open(const std::string &name, unsigned int slots = 32, size_t slot_events = 32768)
+    {
+        pending = nullptr;
+        return ring.create(name, T::tag, sizeof(T), slots, slot_events);
+    }
+
+    void close() { pending = nullptr; ring.close(); }
+    void interrupt() { ring.interrupt(); }
+    void resume() { ring.resume(); }
+    bool isOpen() const { return ring.isOpen(); }
+
+    /// \brief point p at the next free slot, so its events are written in
+    /// place and write(p) only publishes them. Blocks while a reader still
+    /// holds the slot. Events beyond the slot size go to p's own storage.
+    template <typename P>
+    bool prepare(P &p)
+    {
+        if(!pending) pending = ring.acquire();
+        if(!pending) {
+            //stop writing to a slot that was already published
+            p.detach();
+            return false;
+        }
+        p.wrap((T *)shmemRing::events(pending), ring.slotEvents());
+        return true;
+    }
+
+    /// \brief copy count events to the next free slots, sharing the
+    /// duration between the slots by events. Blocks while a reader still
+    /// holds a slot.
+    bool write(const T *data, size_t count, const yarp::os::Stamp &stamp, double duration)
+    {
+        const size_t n = ring.slotEvents();
+        size_t i = 0;
+        do {
+            shmemSlot *slot = pending ? pending : ring.acquire();
+            pending = nullptr;
+            if(!slot) return false;
+            size_t chunk = std::min(count - i, n);
+            if(chunk) std::memcpy(shmemRing::events(slot), (const char *)(data + i), chunk * sizeof(T));
+            publish(slot, chunk, stamp, count ? duration * chunk / count : duration);
+            i += chunk;
+        } while(i < count);
+        return true;
+    }
+
+    template <typename P>
+    bool write(P &p)
+    {
+        //const access does not copy the events of a view
+        const P &events = p;
+        const T *data = events.size() ? &events[0] : nullptr;
+        if(pending && data == (const T *)shmemRing::events(pending)) {
+            publish(pending, p.size(), p.envelope(), p.duration());
+            pending = nullptr;
+            return true;
+        }
+        return write(data, p.size(), p.envelope(), p.duration());
+    }
+};
+
+/// \brief reads ev::packet data from a shared memory ring written by
+/// ev::shmemWriter. Packets are views of the shared memory, valid until the
+/// next read, and must not be modified.
+template <typename T>
+class shmemReader
+{
+private:
+    shmemRing ring;
+
+public:
+
+    bool open(const std::string &name)
+    {
+        return ring.attach(name, T::tag, sizeof(T));
+    }
+
+    void close() { ring.close(); }
+    void interrupt() { ring.interrupt(); }
+    void resume() { ring.resume(); }
+    void release() { ring.release(); }
+    void release(uint64_t seq) { ring.release(seq); }
+    bool isOpen() const { return ring.isOpen(); }
+    uint64_t dropped() const { return ring.dropped(); }
+    size_t slots() const { return ring.slots(); }
+
+    /// \brief point p at the next packet in shared memory. The previous
+    /// packet is released back to the writer.
+    template <typename P>
+    bool read(P &p, bool wait = true)
+    {
+        const shmemSlot *slot = ring.next(wait);
+        if(!slot) return false;
+        p.view((const T *)shmemRing::events(slot), slot->count);
+        p.duration(slot->duration);
+        p.envelope() = yarp::os::Stamp(slot->id, slot->timestamp);
+        return true;
+    }
+
+    /// \brief point p at the next packet in shared memory, keeping the
+    /// packets read before it until release(seq). seq is the sequence number
+    /// of the packet.
+    template <typename P>
+    bool hold(P &p, uint64_t &seq, bool wait = true)
+    {
+        const shmemSlot *slot = ring.hold(wait);
+        if(!slot) return false;
+        p.view((const T *)shmemRing::events(slot), slot->count);
+        p.duration(slot->duration);
+        p.envelope() = yarp::os::Stamp(slot->id, slot->timestamp);
+        seq = slot->seq;
+        return true;
+    }
+};
+
+}
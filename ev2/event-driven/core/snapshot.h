@@ -0,0 +1,71 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ev {
+
+/// \brief passes the latest state from one writer thread to one reader
+/// thread without either waiting for the other. The writer fills back() and
+/// publish()es it, the reader takes the most recent publish with latest().
+/// Neither buffer is touched by the other thread until it is handed over, so
+/// the reader always sees a complete state.
+template <typename T>
+class tripleBuffer
+{
+public:
+
+    /// \brief the buffer the writer fills before publish()
+    T &back() { return buffers[back_i]; }
+
+    /// \brief hand over back(), swapping in the oldest buffer to fill next
+    void publish()
+    {
+        back_i = middle.exchange(back_i | fresh_bit, std::memory_order_acq_rel) & index_mask;
+    }
+
+    /// \brief whether a buffer was published since the last latest()
+    bool fresh() const
+    {
+        return middle.load(std::memory_order_acquire) & fresh_bit;
+    }
+
+    /// \brief the most recently published buffer, which the writer does not
+    /// touch until the next call
+    T &latest()
+    {
+        if(fresh())
+            front_i = middle.exchange(front_i, std::memory_order_acq_rel) & index_mask;
+        return buffers[front_i];
+    }
+
+private:
+
+    static const uint8_t index_mask = 0x03;
+    static const uint8_t fresh_bit = 0x04;
+
+    T buffers[3];
+    uint8_t back_i{0};
+    std::atomic<uint8_t> middle{1};
+    uint8_t front_i{2};
+};
+
+}
@@ -0,0 +1,132 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "event-driven/core/trace.h"
+#include <yarp/os/LogStream.h>
+#include <cmath>
+#include <sstream>
+
+namespace ev {
+
+void latencyHistogram::add(double seconds)
+{
+    int i = 0;
+    if(seconds > lowest)
+        i = 1 + std::min((int)(std::log10(seconds / lowest) * per_decade), per_decade * decades);
+    bins[i]++;
+    n++;
+}
+
+void latencyHistogram::clear()
+{
+    std::fill(bins.begin(), bins.end(), 0);
+    n = 0;
+}
+
+double latencyHistogram::percentile(double q) const
+{
+    if(!n) return 0.0;
+    uint64_t target = std::ceil(q * n);
+    if(!target) target = 1;
+    uint64_t total = 0;
+    size_t i = 0;
+    for(; i < bins.size(); i++) {
+        total += bins[i];
+        if(total >= target) break;
+    }
+    if(i == 0) return 0.0;
+    //upper edge of the bucket
+    return lowest * std::pow(10.0, (double)i / per_decade);
+}
+
+traceCollector::traceCollector(double period) : PeriodicThread(period)
+{
+}
+
+bool traceCollector::open(const std::string &port_name)
+{
+    if(!port.open(port_name)) {
+        yError() << "Could not open trace port" << port_name;
+        return false;
+    }
+    return start();
+}
+
+void traceCollector::close()
+{
+    stop();
+    port.close();
+}
+
+latencyHistogram& traceCollector::stage(const std::string &name)
+{
+    for(auto &s : stages)
+        if(s.first == name) return s.second;
+    stages.emplace_back(name, latencyHistogram());
+    return stages.back().second;
+}
+
+void traceCollector::add(double capture, const std::vector<traceHop> &hops, double now)
+{
+    std::lock_guard<std::mutex> lk(m);
+    double previous = capture;
+    for(auto &h : hops) {
+        stage(h.module + "/process").add(h.written - previous);
+        double read = h.read > 0.0 ? h.read : now;
+        stage(h.module + "/transport").add(read - h.written);
+        previous = read;
+    }
+    //waiting to be processed by the collecting module
+    if(!hops.empty() && hops.back().read > 0.0)
+        stage("queued").add(now - hops.back().read);
+    stage("total").add(now - capture);
+}
+
+std::string traceCollector::summary()
+{
+    std::lock_guard<std::mutex> lk(m);
+    std::stringstream ss;
+    ss.precision(3);
+    for(auto &s : stages) {
+        ss << s.first << ": " << s.second.percentile(0.5) * 1e3 << " / "
+           << s.second.percentile(0.99) * 1e3 << " / "
+           << s.second.percentile(0.999) * 1e3 << " ms (p50/p99/p999, "
+           << s.second.count() << " packets)" << std::endl;
+    }
+    return ss.str();
+}
+
+void traceCollector::run()
+{
+    std::lock_guard<std::mutex> lk(m);
+    yarp::os::Bottle &b = port.prepare();
+    b.clear();
+    for(auto &s : stages) {
+        if(!s.second.count()) continue;
+        yarp::os::Bottle &stage = b.addList();
+        stage.addString(s.first);
+        stage.addInt32(s.second.count());
+        stage.addFloat64(s.second.percentile(0.5) * 1e3);
+        stage.addFloat64(s.second.percentile(0.99) * 1e3);
+        stage.addFloat64(s.second.percentile(0.999) * 1e3);
+        s.second.clear();
+    }
+    port.write();
+}
+
+}
@@ -0,0 +1,98 @@
+/*
+ *   Copyright (C) 2024 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/PeriodicThread.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ev {
+
+/// \brief one module a traced packet passed through: when the module wrote
+/// the packet and when the next module read it (0 until then)
+struct traceHop
+{
+    std::string module;
+    double written;
+    double read;
+};
+
+/// \brief latency histogram with logarithmic buckets from 1 us to 100 s
+/// (~6% resolution)
+class latencyHistogram
+{
+public:
+
+    void add(double seconds);
+    void clear();
+    size_t count() const { return n; }
+
+    /// \brief the latency below which fraction q (0-1) of samples fall
+    double percentile(double q) const;
+
+private:
+    static constexpr int per_decade = 40;
+    static constexpr int decades = 8;
+    static constexpr double lowest = 1e-6;
+
+    std::vector<uint64_t> bins = std::vector<uint64_t>(per_decade * decades + 2, 0);
+    size_t n{0};
+};
+
+/// \brief collects the hops of traced packets and publishes the latency of
+/// each hop on a port, as a bottle of
+/// (name count p50 p99 p999) lists, in milliseconds, once per period.
+///
+/// For each module "<module>/process" is the time from reading the packet
+/// (or its capture) to writing it, "<module>/transport" the time from
+/// writing to the next module receiving it, "queued" the time from being
+/// received to being read by the collecting module, and "total" the age of
+/// the packet when it reached the collector.
+class traceCollector : public yarp::os::PeriodicThread
+{
+public:
+
+    traceCollector(double period = 1.0);
+
+    bool open(const std::string &port_name);
+    void close();
+
+    /// \brief record a packet captured at capture (seconds) with hops, read
+    /// by the collecting module at now
+    void add(double capture, const std::vector<traceHop> &hops, double now);
+
+    /// \brief the current percentiles as text, for logging
+    std::string summary();
+
+private:
+
+    std::mutex m;
+    std::vector< std::pair<std::string, latencyHistogram> > stages;
+    yarp::os::BufferedPort<yarp::os::Bottle> port;
+
+    latencyHistogram& stage(const std::string &name);
+    void run() override;
+};
+
+}
@@ -103,26 +103,6 @@ public:
 
 };
 
-class benchmark {
-private:
-
-    bool initialised;
-    std::ifstream totals_file;
-    std::ifstream process_file;
-
-    unsigned long int prevTotal;
-    unsigned long int prevProcess;
-    double perc;
-
-public:
-
-    benchmark();
-    ~benchmark();
-    bool isReady();
-    double getProcessorUsage();
-
-};
-
 /// \brief an efficient structure for storing sensor resolution
 struct resolution {
     unsigned int width:10;
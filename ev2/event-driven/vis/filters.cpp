@@ -47,15 +47,30 @@ void spatialFilter::initialise(int height, int width, double period = 0.1, int r
 }
 
 bool spatialFilter::check(const AE& v, const double ts)
+{
+    return check(v.x, v.y, v.p, ts);
+}
+
+bool spatialFilter::check(int x, int y, int p, const double ts)
 {
     static int fr = 2*range+1; 
     bool pass = true;
-    if(ts - period > saes[v.p].at<double>(v.y+range, v.x+range))
+    if(ts - period > saes[p].at<double>(y+range, x+range))
         pass = false;
-    saes[v.p]({(int)v.x, (int)v.y, fr, fr}) = ts;
+    saes[p]({x, y, fr, fr}) = ts;
     return pass;
 }
 
+size_t spatialFilter::check(soa_batch &batch, const double ts)
+{
+    size_t kept = 0;
+    for(size_t i = 0; i < batch.size(); i++)
+        if(check(batch.x[i], batch.y[i], batch.p[i], batch.time(i, ts)))
+            batch.copy(kept++, i);
+    batch.resize(kept);
+    return kept;
+}
+
 
 vNoiseFilter::vNoiseFilter() : x_sfilter(false), x_tfilter(false), t_sfilter(0),
     s_sfilter(1), t_tfilter(0) {}
@@ -125,6 +140,16 @@ bool vNoiseFilter::check(int x, int y, int p, double t)
     return add;
 }
 
+size_t vNoiseFilter::check(soa_batch &batch, double t)
+{
+    size_t kept = 0;
+    for(size_t i = 0; i < batch.size(); i++)
+        if(check(batch.x[i], batch.y[i], batch.p[i], batch.time(i, t)))
+            batch.copy(kept++, i);
+    batch.resize(kept);
+    return kept;
+}
+
 }
 
 
@@ -61,6 +61,11 @@ public:
     /// \returns false if the event is noise
     bool check(int x, int y, int p, double t);
 
+    /// \brief removes noise from a batch, keeping the order of the signal
+    /// events. t is the time of the final event (see ev::soa_batch::time)
+    /// \returns the number of events kept
+    size_t check(soa_batch &batch, double t);
+
 };
 
 class spatialFilter
@@ -74,6 +79,8 @@ public:
     spatialFilter() {};
     void initialise(int height, int width, double period, int range);
     bool check(const AE& v, const double ts);
+    bool check(int x, int y, int p, const double ts);
+    size_t check(soa_batch &batch, const double ts);
 
 };
 